@@ -6,7 +6,7 @@
 #include "cache.h"
 #include "print_helpers.h"
 
-cache_t *make_cache(int capacity, int block_size, int assoc, enum protocol_t protocol, bool lru_on_invalidate_f){
+cache_t *make_cache(long capacity, int block_size, int assoc, enum protocol_t protocol, bool lru_on_invalidate_f){
   cache_t *cache = malloc(sizeof(cache_t));
   cache->stats = make_cache_stats();
   
@@ -16,36 +16,86 @@ cache_t *make_cache(int capacity, int block_size, int assoc, enum protocol_t pro
 
   // Calculate cache parameters
   cache->n_cache_line = capacity / block_size;
-  cache->n_set = capacity / (block_size * assoc);
+  cache->n_set = cache->n_cache_line / assoc;
   cache->n_offset_bit = log2(block_size);
   cache->n_index_bit = log2(cache->n_set);
-  cache->n_tag_bit = 32 - (cache->n_index_bit + cache->n_offset_bit);
+  cache->n_tag_bit = ADDRESS_SIZE - (cache->n_index_bit + cache->n_offset_bit);
+
+  // Precompute the decode shifts and masks used by the get_* helpers
+  cache->tag_shift = cache->n_offset_bit + cache->n_index_bit;
+  cache->index_mask = (unsigned long)cache->n_set - 1;
+  cache->block_addr_mask = ~((unsigned long)block_size - 1);
 
   // Create the cache lines and the array of LRU bits
+  // (all ways are carved out of one allocation so multi-GB caches don't
+  // pay for millions of tiny mallocs)
   cache->lines = malloc(cache->n_set * sizeof(cache_line_t*));
-  for (int i = 0; i < cache->n_set; i++) {
-    cache->lines[i] = malloc(assoc * sizeof(cache_line_t));
-  }
+  cache_line_t *line_pool = malloc(cache->n_cache_line * sizeof(cache_line_t));
   cache->lru_way = malloc(cache->n_set * sizeof(int));
+  if (cache->lines == NULL || line_pool == NULL || cache->lru_way == NULL) {
+    printf("Unable to allocate %ld cache lines. Exiting...\n", cache->n_cache_line);
+    exit(EXIT_FAILURE);
+  }
+  for (long i = 0; i < cache->n_set; i++) {
+    cache->lines[i] = &line_pool[i * assoc];
+  }
 
   // Initialize cache tags to 0, dirty bits to false, state to INVALID, and LRU bits to 0
-  for (int i = 0; i < cache->n_set; i++) {
+  for (long i = 0; i < cache->n_set; i++) {
     for (int j = 0; j < cache->assoc; j++) {
       cache->lines[i][j].tag = 0;
       cache->lines[i][j].dirty_f = false;
       cache->lines[i][j].state = INVALID;
     }
   }
-  for(int i = 0; i < cache->n_set; i++){
+  for(long i = 0; i < cache->n_set; i++){
     cache->lru_way[i] = 0;
   }
 
   cache->protocol = protocol;
   cache->lru_on_invalidate_f = lru_on_invalidate_f;
+
+  cache->writeback_f = false;
+  cache->invalidate_f = false;
+  cache->print_set = 0;
+  cache->print_way = 0;
+  cache->writeback_addr = 0;
+
+  cache->mshr = NULL;
+  cache->victim = NULL;
+  cache->snoop_filter = NULL;
+  cache->tlb = NULL;
   
   return cache;
 }
 
+/* Attaches a snoop filter, seeded with the (tag 0) block every line
+ * starts out holding so later evictions keep the counts balanced. */
+void attach_snoop_filter(cache_t *cache) {
+  long n_block = cache->n_cache_line + (cache->victim ? cache->victim->n_entry : 0);
+  cache->snoop_filter = make_snoop_filter(n_block);
+  for (long i = 0; i < cache->n_set; i++) {
+    for (int j = 0; j < cache->assoc; j++)
+      snoop_filter_insert(cache->snoop_filter, line_block_addr(cache, i, &cache->lines[i][j]));
+  }
+}
+
+void free_cache(cache_t *cache) {
+  free(cache->lines[0]);  // the line pool, see make_cache
+  free(cache->lines);
+  free(cache->lru_way);
+  free(cache->stats);
+  if (cache->mshr != NULL)
+    free_mshr(cache->mshr);
+  if (cache->victim != NULL)
+    free_victim_cache(cache->victim);
+  if (cache->snoop_filter != NULL)
+    free_snoop_filter(cache->snoop_filter);
+  if (cache->tlb != NULL)
+    free_tlb(cache->tlb);
+  free(cache);
+}
+
 /* Given a configured cache, returns the tag portion of the given address.
  *
  * Example: a cache with 4 bits each in tag, index, offset
@@ -53,7 +103,7 @@ cache_t *make_cache(int capacity, int block_size, int assoc, enum protocol_t pro
  * in decimal -- get_cache_tag(3921) returns 15 
  */
 unsigned long get_cache_tag(cache_t *cache, unsigned long addr) {
-  return addr >> (32 - cache->n_tag_bit);
+  return addr >> cache->tag_shift;
 }
 
 /* Given a configured cache, returns the index portion of the given address.
@@ -63,9 +113,7 @@ unsigned long get_cache_tag(cache_t *cache, unsigned long addr) {
  * in decimal -- get_cache_index(3921) returns 5
  */
 unsigned long get_cache_index(cache_t *cache, unsigned long addr) {
-  unsigned long index = addr << (cache->n_tag_bit + 32);
-  index = index >> (cache->n_tag_bit + cache->n_offset_bit + 32);
-  return index;
+  return (addr >> cache->n_offset_bit) & cache->index_mask;
 }
 
 /* Given a configured cache, returns the given address with the offset bits zeroed out.
@@ -75,8 +123,7 @@ unsigned long get_cache_index(cache_t *cache, unsigned long addr) {
  * in decimal -- get_cache_block_addr(3921) returns 3920
  */
 unsigned long get_cache_block_addr(cache_t *cache, unsigned long addr) {
-  addr = addr >> cache->n_offset_bit;
-  return addr << cache->n_offset_bit;
+  return addr & cache->block_addr_mask;
 }
 
 /* 
@@ -86,6 +133,17 @@ void change_lru(cache_t *cache, unsigned long index, int way){
     cache->lru_way[index] = (way + 1 >= cache->assoc) ? 0 : (way + 1);
 }
 
+/*
+*  Remembers the block address of a dirty line leaving the cache (evicted or
+*  flushed by a snoop), so callers can see the writeback after access_cache returns.
+*/
+void log_writeback(cache_t *cache, unsigned long index, cache_line_t *line){
+  if (!line->dirty_f)
+    return;
+  cache->writeback_f = true;
+  cache->writeback_addr = line_block_addr(cache, index, line);
+}
+
 /*
 * This method has the same functionallity as
 * access_cache() below, but specifically for msi protocol caches
@@ -95,7 +153,7 @@ bool access_msi_cache(cache_t *cache, unsigned long addr, enum action_t action){
   if (cache->n_index_bit != 0)  //only get cache index if cache != fully associative
     index = get_cache_index(cache, addr);
   unsigned long tag = get_cache_tag(cache, addr);
-  log_set(index);
+  cache->print_set = index;
   cache_line_t* blockPtr = cache->lines[index]; //blockPtr points to the array of $ lines at index (the ways of the set)
 
   int way_hitInvalid = 0;
@@ -106,11 +164,12 @@ bool access_msi_cache(cache_t *cache, unsigned long addr, enum action_t action){
         way_hitInvalid = way;
         break;
       }
-      log_way(way);
+      cache->print_way = way;
 
       if (blockPtr->state == SHARED){
         if (action == ST_MISS) {
           blockPtr->state = INVALID;
+          cache->invalidate_f = true;
           update_stats(cache->stats, true, false, false, action);
         }
         else if (action == STORE) {
@@ -126,6 +185,8 @@ bool access_msi_cache(cache_t *cache, unsigned long addr, enum action_t action){
       else { //state == modified
         if (action == ST_MISS || action == LD_MISS){
           blockPtr->state = (action == ST_MISS) ? INVALID : SHARED;
+          cache->invalidate_f = (action == ST_MISS);
+          log_writeback(cache, index, blockPtr);
           update_stats(cache->stats, true, (blockPtr->dirty_f), false, action);
           blockPtr->dirty_f = false;
         }
@@ -143,21 +204,22 @@ bool access_msi_cache(cache_t *cache, unsigned long addr, enum action_t action){
 
   //if addr didn't hit
   if (action == LD_MISS || action == ST_MISS){
-    log_way(cache->lru_way[index]);
+    cache->print_way = cache->lru_way[index];
     update_stats(cache->stats, false, false, false, action);
     return false;
   }
 
   if (blockPtr->tag == tag){  //miss because state was invalid
-    log_way(way_hitInvalid);
+    cache->print_way = way_hitInvalid;
     update_stats(cache->stats, false, false, false, action);
     blockPtr->state = (action == LOAD) ? SHARED : MODIFIED;
     blockPtr->dirty_f = (action == STORE) ? true : false;
     change_lru(cache, index, way_hitInvalid);
   }
   else {  //miss because no tag match
-    log_way(cache->lru_way[index]);
+    cache->print_way = cache->lru_way[index];
     blockPtr = &blockPtr[cache->lru_way[index]]; //blockPtr now points to block about to get evicted
+    log_writeback(cache, index, blockPtr);
     update_stats(cache->stats, false, blockPtr->dirty_f, false, action);  //dirty bit matches writeback bool
     blockPtr->state = (action == LOAD) ? SHARED : MODIFIED;
     blockPtr->dirty_f = (action == STORE) ? true : false;
@@ -175,25 +237,29 @@ bool access_msi_cache(cache_t *cache, unsigned long addr, enum action_t action){
  *   - update the cache statistics (call update_stats)
  * return true if there was a hit, false if there was a miss
  * Use the "get" helper functions above. They make your life easier.
+ * (access_cache() below wraps this with the optional victim cache and
+ * snoop filter)
  */
-bool access_cache(cache_t *cache, unsigned long addr, enum action_t action) {
+bool access_set(cache_t *cache, unsigned long addr, enum action_t action) {
   if (cache->protocol == MSI)  //if cache implements MSI protocol, use access_msi_cache functon
     return access_msi_cache(cache, addr, action);
   unsigned long index = 0;
   if (cache->n_index_bit != 0)
     index = get_cache_index(cache, addr);
-  log_set(index);
+  cache->print_set = index;
   cache_line_t* blockPtr = cache->lines[index];
   unsigned long tag = get_cache_tag(cache, addr);
   for (int i = 0; i < cache->assoc; i++){
     if (blockPtr[i].tag == tag && blockPtr[i].state == VALID){
-      log_way(i);
+      cache->print_way = i;
       if (action == LD_MISS || action == ST_MISS){
         if (cache->protocol == NONE){
           update_stats(cache->stats, true, false, false, action);
           return true;
         }
         blockPtr[i].state = INVALID;
+        cache->invalidate_f = true;
+        log_writeback(cache, index, &blockPtr[i]);
         update_stats(cache->stats, true, blockPtr[i].dirty_f, false, action);
         blockPtr[i].dirty_f = false;
         return true;
@@ -207,17 +273,169 @@ bool access_cache(cache_t *cache, unsigned long addr, enum action_t action) {
   }
   //for cache misses:
   blockPtr = &blockPtr[cache->lru_way[index]];  //blockPtr now points to block about to be evicted
-  log_way(cache->lru_way[index]);
+  cache->print_way = cache->lru_way[index];
   if (cache->protocol == NONE && (action == LD_MISS || action == ST_MISS)){  //with no protocol, ld/st_misses have no effect
     update_stats(cache->stats, false, false, false, action);
     return false;
   }
   update_stats(cache->stats, false, blockPtr->dirty_f, false, action); //simulates writeback if evicted block is dirty
   if (action == LOAD || action == STORE){
+    log_writeback(cache, index, blockPtr);
     blockPtr->dirty_f = (action == STORE); //dirty bit = true if action == store
     blockPtr->tag = tag;
     blockPtr->state = VALID;
     change_lru(cache, index, cache->lru_way[index]);
   }
   return false;
-}
\ No newline at end of file
+}
+
+/* Returns the block address held by a line of the given set. */
+unsigned long line_block_addr(cache_t *cache, unsigned long index, cache_line_t *line) {
+  return (line->tag << cache->tag_shift) | (index << cache->n_offset_bit);
+}
+
+/* Way the block would be filled into: a stale (invalid) copy of the same
+ * tag if the set has one, else the LRU way. Mirrors access_msi_cache. */
+int fill_way(cache_t *cache, unsigned long index, unsigned long tag) {
+  for (int way = 0; way < cache->assoc; way++) {
+    if (cache->lines[index][way].tag == tag)
+      return way;
+  }
+  return cache->lru_way[index];
+}
+
+/* Applies a remote miss to a line sitting in the victim cache, the same
+ * way access_set treats a line of the cache itself. */
+bool snoop_victim(cache_t *cache, victim_line_t *line, enum action_t action) {
+  bool writeback_f = false;
+  cache->victim->n_snoop_hits++;
+  if (cache->protocol == VI || (cache->protocol == MSI && line->state == MODIFIED)) {
+    writeback_f = line->dirty_f;
+    if (writeback_f) {
+      cache->writeback_f = true;
+      cache->writeback_addr = line->block_addr;
+    }
+    line->dirty_f = false;
+    line->state = (cache->protocol == MSI && action == LD_MISS) ? SHARED : INVALID;
+  }
+  else if (cache->protocol == MSI && action == ST_MISS) {
+    line->state = INVALID;
+  }
+  cache->invalidate_f = (line->state == INVALID);
+  if (line->state == INVALID && cache->snoop_filter != NULL)
+    snoop_filter_remove(cache->snoop_filter, line->block_addr);
+  update_stats(cache->stats, true, writeback_f, false, action);
+  return true;
+}
+
+/* Pushes a line evicted from the cache into the victim cache. Whatever
+ * falls out of the victim cache in turn leaves the core, and is written
+ * back if dirty. */
+void evict_to_victim(cache_t *cache, unsigned long block_addr, cache_line_t *line) {
+  victim_line_t evicted;
+  if (victim_insert(cache->victim, block_addr, line->state, line->dirty_f, &evicted)) {
+    if (evicted.dirty_f) {
+      cache->stats->n_writebacks++;
+      cache->writeback_f = true;
+      cache->writeback_addr = evicted.block_addr;
+    }
+    if (cache->snoop_filter != NULL)
+      snoop_filter_remove(cache->snoop_filter, evicted.block_addr);
+  }
+}
+
+/* Moves a victim cache hit back into its set, swapping it with the line
+ * it is filled over so the two structures stay exclusive. */
+void swap_from_victim(cache_t *cache, unsigned long index, unsigned long tag, victim_line_t *hit) {
+  int way = fill_way(cache, index, tag);
+  cache_line_t *line = &cache->lines[index][way];
+  cache_line_t displaced = *line;
+  unsigned long displaced_addr = line_block_addr(cache, index, line);
+
+  line->tag = tag;
+  line->state = hit->state;
+  line->dirty_f = hit->dirty_f;
+  hit->state = INVALID;
+  // any slot the hit freed is reused by the displaced line
+  if (displaced.state != INVALID && displaced_addr != hit->block_addr)
+    evict_to_victim(cache, displaced_addr, &displaced);
+  else if (cache->snoop_filter != NULL)
+    snoop_filter_remove(cache->snoop_filter, displaced_addr);
+}
+
+/* Accesses the cache as access_set does, with the optional structures
+ * attached to it:
+ *   - a remote miss the snoop filter rules out skips the lookup (it is
+ *     still counted as a bus snoop)
+ *   - a miss that hits in the victim cache is swapped back into the cache
+ *     and completes as a hit
+ *   - a line evicted on a fill goes to the victim cache, and is only
+ *     written back if dirty when it leaves the victim cache
+ */
+bool access_cache(cache_t *cache, unsigned long addr, enum action_t action) {
+  cache->writeback_f = false;
+  cache->invalidate_f = false;
+  if (cache->victim == NULL && cache->snoop_filter == NULL)
+    return access_set(cache, addr, action);
+
+  unsigned long index = get_cache_index(cache, addr);
+  unsigned long tag = get_cache_tag(cache, addr);
+  unsigned long block_addr = get_cache_block_addr(cache, addr);
+
+  if (action == LD_MISS || action == ST_MISS) {
+    if (cache->snoop_filter != NULL) {
+      cache->snoop_filter->n_snoops++;
+      if (!snoop_filter_may_hold(cache->snoop_filter, block_addr)) {
+        cache->snoop_filter->n_filtered++;
+        // same accounting access_set does for a snoop that misses
+        update_stats(cache->stats, false,
+                cache->protocol == VI && cache->lines[index][cache->lru_way[index]].dirty_f,
+                false, action);
+        return false;
+      }
+    }
+    victim_line_t *line = (cache->victim != NULL) ? victim_find(cache->victim, block_addr) : NULL;
+    if (line != NULL)
+      return snoop_victim(cache, line, action);
+    return access_set(cache, addr, action);
+  }
+
+  // CPU access: is the block valid in its set?
+  bool present_f = false;
+  for (int way = 0; way < cache->assoc; way++) {
+    if (cache->lines[index][way].tag == tag && cache->lines[index][way].state != INVALID)
+      present_f = true;
+  }
+  if (!present_f && cache->victim != NULL) {
+    cache->victim->n_lookups++;
+    victim_line_t *hit = victim_find(cache->victim, block_addr);
+    if (hit != NULL) {
+      cache->victim->n_hits++;
+      swap_from_victim(cache, index, tag, hit);
+      present_f = true;
+    }
+  }
+  if (present_f)
+    return access_set(cache, addr, action);
+
+  // miss: the dirty line filled over is written back when it leaves the
+  // victim cache, not now
+  cache_line_t *lru = &cache->lines[index][cache->lru_way[index]];
+  cache_line_t old = *lru;
+  unsigned long old_addr = line_block_addr(cache, index, lru);
+  if (cache->victim != NULL)
+    lru->dirty_f = false;
+  bool hit_f = access_set(cache, addr, action);
+  if (lru->tag == old.tag) {  // filled elsewhere, nothing left the set
+    lru->dirty_f |= old.dirty_f;
+    return hit_f;
+  }
+
+  if (cache->snoop_filter != NULL)
+    snoop_filter_insert(cache->snoop_filter, block_addr);
+  if (cache->victim != NULL && old.state != INVALID)
+    evict_to_victim(cache, old_addr, &old);
+  else if (cache->snoop_filter != NULL)
+    snoop_filter_remove(cache->snoop_filter, old_addr);
+  return hit_f;
+}
@@ -4,8 +4,11 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include "cache_stats.h"
+#include "mshr.h"
+#include "tlb.h"
 
-#define ADDRESS_SIZE 32  // in bits
+#define ADDRESS_SIZE 64  // in bits
+#define MAX_LOG_CAPACITY 36  // largest cache accepted on the command line (64GB)
 #define HIT 1
 #define MISS 0
 
@@ -15,6 +18,10 @@ enum state_t { INVALID, VALID, SHARED, MODIFIED };
 // coherence protocol for simulation
 enum protocol_t { NONE, VI, MSI }; 
 
+// these need state_t
+#include "victim_cache.h"
+#include "snoop_filter.h"
+
 typedef struct {
   // tags are big numbers, store them as longs
   unsigned long tag;
@@ -23,17 +30,23 @@ typedef struct {
 } cache_line_t;
 
 typedef struct {
-  int capacity;    // in Bytes
+  long capacity;   // in Bytes, may exceed 2^31 for large LLCs
   int block_size;  // in Bytes
   int assoc;       // 1 for direct mapped, 2 for 2-way set associative, etc.
 
   // Modify the constructor to properly initialize these variables
-  int n_set;
-  int n_cache_line;
+  long n_set;
+  long n_cache_line;
   int n_offset_bit;
   int n_index_bit;
   int n_tag_bit;
 
+  // address decode values precomputed by make_cache so that field
+  // extraction on the hot path is a single shift and/or mask
+  int tag_shift;                 // n_offset_bit + n_index_bit
+  unsigned long index_mask;      // n_set - 1, applied after >> n_offset_bit
+  unsigned long block_addr_mask; // clears the offset bits
+
 
   // cache lines stored in a 2D Array:
   // - 1st dimension = which set
@@ -49,10 +62,33 @@ typedef struct {
 
   enum protocol_t protocol;
   bool lru_on_invalidate_f;
+
+  // set and way of the last access, for verbose output
+  long print_set;
+  int print_way;
+
+  // set by access_cache when the access wrote a dirty block back
+  bool writeback_f;
+  unsigned long writeback_addr;
+  // set by access_cache when a remote miss invalidated this core's copy
+  bool invalidate_f;
+
+  // outstanding miss tracking, NULL for a blocking cache
+  mshr_t *mshr;
+
+  // optional structures consulted by access_cache, NULL when off
+  victim_cache_t *victim;
+  snoop_filter_t *snoop_filter;
+
+  // translation for this core's accesses, NULL to use trace addresses as is
+  tlb_t *tlb;
 	
 } cache_t;
 
-cache_t *make_cache(int capacity, int block_size, int assoc, enum protocol_t protocol, bool lru_on_invalidate_f);
+cache_t *make_cache(long capacity, int block_size, int assoc, enum protocol_t protocol, bool lru_on_invalidate_f);
+void attach_snoop_filter(cache_t *cache);
+void free_cache(cache_t *cache);
+unsigned long line_block_addr(cache_t *cache, unsigned long index, cache_line_t *line);
 unsigned long get_cache_tag(cache_t *cache, unsigned long addr);
 unsigned long get_cache_index(cache_t *cache, unsigned long addr);
 unsigned long get_cache_block_addr(cache_t *cache, unsigned long addr);
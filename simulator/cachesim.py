@@ -0,0 +1,122 @@
+#!/usr/bin/python3
+
+# In-process access to the simulator through libcachesim.so (`make`).
+#
+#   import cachesim
+#   t = cachesim.Trace('trace.4t.short.txt')
+#   t.run(14, 6, 4, protocol='msi', cores=4)[0]['hit_rate']
+#   t.run_batch([dict(cap=c, bsize=6, assoc=2) for c in range(10, 22)])
+#
+# ctypes drops the GIL for the duration of every library call, so batches
+# on different traces can run in parallel Python threads.
+
+import ctypes
+import os
+
+PROTOCOLS = {'none': 0, 'vi': 1, 'msi': 2}
+INTERLEAVES = {'file': 0, 'ts': 1, 'rr': 2, 'skew': 3}
+
+
+class CacheStats(ctypes.Structure):
+    # mirrors cache_stats_t in cache_stats.h
+    _fields_ = [
+        ('n_cpu_accesses', ctypes.c_long),
+        ('n_hits', ctypes.c_long),
+        ('n_stores', ctypes.c_long),
+        ('n_writebacks', ctypes.c_long),
+        ('n_bus_snoops', ctypes.c_long),
+        ('n_snoop_hits', ctypes.c_long),
+        ('n_upgrade_miss', ctypes.c_long),
+        ('hit_rate', ctypes.c_double),
+        ('B_bus_to_cache', ctypes.c_long),
+        ('B_cache_to_bus_wb', ctypes.c_long),
+        ('B_cache_to_bus_wt', ctypes.c_long),
+        ('B_total_traffic_wb', ctypes.c_long),
+        ('B_total_traffic_wt', ctypes.c_long),
+    ]
+
+
+class SimConfig(ctypes.Structure):
+    # mirrors sim_config_t in sim_api.h
+    _fields_ = [
+        ('log_capacity', ctypes.c_int),
+        ('log_block_size', ctypes.c_int),
+        ('assoc', ctypes.c_int),
+        ('protocol', ctypes.c_int),
+        ('n_core', ctypes.c_int),
+        ('lru_on_invalidate_f', ctypes.c_int),
+        ('insn_limit', ctypes.c_long),
+    ]
+
+
+STAT_NAMES = [name for name, _ in CacheStats._fields_]
+
+_lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), 'libcachesim.so'))
+_lib.load_trace.restype = ctypes.c_void_p
+_lib.load_trace.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_ulong]
+_lib.free_loaded_trace.argtypes = [ctypes.c_void_p]
+_lib.run_config.argtypes = [ctypes.c_void_p, ctypes.POINTER(SimConfig), ctypes.POINTER(CacheStats)]
+_lib.run_batch.argtypes = [ctypes.c_void_p, ctypes.POINTER(SimConfig), ctypes.c_int,
+                           ctypes.POINTER(CacheStats), ctypes.c_int]
+
+
+def make_config(cap, bsize, assoc, protocol='none', cores=1, lru=False, limit=0):
+    # cap and bsize are log2 values, as with -cache
+    return SimConfig(cap, bsize, assoc, PROTOCOLS[protocol], cores, int(lru), limit)
+
+
+def stats_dict(stats):
+    d = {name: getattr(stats, name) for name in STAT_NAMES}
+    d['n_misses'] = stats.n_cpu_accesses - stats.n_hits
+    d['miss_rate'] = 1 - stats.hit_rate
+    return d
+
+
+class Trace:
+    """A trace parsed once into memory. The name is looked up under trace/
+    like -t; with interleave != 'file' it holds a %d for the core id."""
+
+    def __init__(self, name, cores=1, interleave='file', skew=0):
+        self._handle = _lib.load_trace(name.encode(), cores, INTERLEAVES[interleave], skew)
+        if not self._handle:
+            raise OSError('unable to load trace %r (see the message above)' % name)
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            _lib.free_loaded_trace(self._handle)
+            self._handle = None
+
+    def run(self, cap, bsize, assoc, protocol='none', cores=1, lru=False, limit=0):
+        """Simulates one config, returning a stats dict per core."""
+        config = make_config(cap, bsize, assoc, protocol, cores, lru, limit)
+        stats = (CacheStats * cores)()
+        if _lib.run_config(self._handle, ctypes.byref(config), stats) != 0:
+            raise ValueError('invalid config for this trace: %r' % (
+                    (cap, bsize, assoc, protocol, cores),))
+        return [stats_dict(s) for s in stats]
+
+    def run_batch(self, configs, as_array=False):
+        """Simulates a list of configs (dicts of run() arguments) in one call.
+        Returns a list of per-core stats dict lists or, with as_array, a NumPy
+        array indexed [config, core, STAT_NAMES index] (NaN where a config
+        has fewer cores or failed)."""
+        configs = [make_config(**c) for c in configs]
+        stride = max([c.n_core for c in configs] + [1])
+        stats = (CacheStats * (stride * len(configs)))()
+        for s in stats:
+            s.n_cpu_accesses = -1  # marks entries the library never filled
+        array = (SimConfig * len(configs))(*configs)
+        _lib.run_batch(self._handle, array, len(configs), stats, stride)
+
+        if as_array:
+            import numpy as np
+            out = np.full((len(configs), stride, len(STAT_NAMES)), np.nan)
+            for i in range(len(configs)):
+                for core in range(stride):
+                    s = stats[i * stride + core]
+                    if s.n_cpu_accesses >= 0:
+                        out[i, core] = [getattr(s, n) for n in STAT_NAMES]
+            return out
+        return [[stats_dict(stats[i * stride + core]) for core in range(c.n_core)]
+                if stats[i * stride].n_cpu_accesses >= 0 else None
+                for i, c in enumerate(configs)]
@@ -0,0 +1,26 @@
+#include <stdio.h>
+
+#include "fnv_hash.h"
+
+unsigned long fnv1a(unsigned long hash, const unsigned char *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= buf[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/* Folds the raw bytes of a trace file into an FNV-1a hash (start from
+ * FNV_OFFSET_BASIS), so edits to a trace invalidate every entry recorded
+ * against it. */
+unsigned long hash_trace_file(unsigned long hash, const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return hash;
+  unsigned char buf[1 << 16];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    hash = fnv1a(hash, buf, n);
+  fclose(f);
+  return hash;
+}
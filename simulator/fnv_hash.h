@@ -0,0 +1,14 @@
+#ifndef __FNV_HASH_H
+#define __FNV_HASH_H
+
+#include <stddef.h>
+
+/* 64-bit FNV-1a, used to key the result store by trace contents and
+ * configuration. Chain calls starting from FNV_OFFSET_BASIS. */
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325UL
+#define FNV_PRIME 0x100000001b3UL
+
+unsigned long fnv1a(unsigned long hash, const unsigned char *buf, size_t len);
+unsigned long hash_trace_file(unsigned long hash, const char *path);
+
+#endif  // FNV_HASH
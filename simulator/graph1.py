@@ -17,6 +17,7 @@ cores = [1]
 protocol='none'
 
 expname='exp1'
+store='results/store'
 figname='graph1.png'
 
 
@@ -29,8 +30,8 @@ def get_stats(logfile, key):
 
 def run_exp(logfile, core, cap, bsize, assoc):
     trace = 'trace.%dt.long.txt' % core
-    cmd="./p5 -t %s -p %s -n %d -cache %d %d %d >> %s" % (
-            trace, protocol, core, cap, bsize, assoc, logfile)
+    cmd="./p5 -t %s -p %s -n %d -cache %d %d %d -r %s >> %s" % (
+            trace, protocol, core, cap, bsize, assoc, store, logfile)
     print(cmd)
     os.system(cmd)
 
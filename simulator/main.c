@@ -5,7 +5,7 @@
 #include "print_helpers.h"
 #include "simulator.h"
 
-int capacity;
+long capacity;
 int block_size;
 int assoc;
 
@@ -19,8 +19,27 @@ void printUsage() {
             "and <bsize> are given as the log of the value.\n");
     printf("  -p|protocol none|vi|msi         which coherence protocol\n");
     printf("  -t|trace <tracename>            Name of trace \n");
+    printf("  -m|merge ts|rr|skew <n>         Merge per-core traces (<tracename> has a\n"
+           "                                  %%d for the core id) by timestamp, round\n"
+           "                                  robin, or timestamp + core * <n>\n");
     printf("  -i|lru_on_invalidate            update LRU on line invalidation\n");
     printf("  -l|limit <n>                    Simulate only first n insns \n");
+    printf("  -S|sockets <s0,s1,...>          Socket of each core, e.g. 0,0,1,1\n");
+    printf("  -H|home_interleave <n>          Interleave home sockets on 2^<n> B (default 12)\n");
+    printf("  -P|profile <prefix>             Write reuse distance and working set\n"
+           "                                  histograms to <prefix>.reuse/.wss.txt\n");
+    printf("  -W|window <n>                   Sliding working set window in accesses\n"
+           "                                  (default 10000)\n");
+    printf("  -x|self_profile                 Report the simulator's own host cycles,\n"
+           "                                  insns and LLC misses per phase\n");
+    printf("  -V|victim <n>                   Add an <n> entry victim cache to every core\n");
+    printf("  -F|snoop_filter                 Filter remote snoops for blocks a core can't hold\n");
+    printf("  -T|tlb <n> <assoc> 4k|2m|1g     Per-core TLB; misses walk the page table\n"
+           "                                  through the data cache\n");
+    printf("  -M|mshr <n> <latency>           Non-blocking caches with <n> MSHRs per core\n"
+           "                                  and a <latency> cycle miss penalty\n");
+    printf("  -r|result_store <dir>           Reuse/record results in <dir>\n");
+    printf("  -f|filter <tracename>           Write the miss/writeback stream to <tracename>\n");
     printf("\nExamples:\n");
     printf("  shell>  ./p5 -t route.1t.short.txt -cache 9 5 1 \n");
     printf("  shell>  ./p5 -t route.1t.short.txt -cache 12 6 2 \n");
@@ -76,16 +95,16 @@ int parse_args(char **args, int num_args, simulator_t *sim) {
                 exit(1);
             }
             int log_cap = atoi(args[i++]);
-            capacity = 1 << log_cap;
+            capacity = 1L << log_cap;
             int log_block_size = atoi(args[i++]);
             block_size = 1 << log_block_size;
             assoc = atoi(args[i++]);
-            if (log_cap > 25 || log_cap < 0 || log_block_size > 25 ||
-                    log_block_size < 0 || assoc == 0) {
+            if (log_cap > MAX_LOG_CAPACITY || log_cap < 0 || log_block_size > 25 ||
+                    log_block_size < 0 || assoc <= 0) {
                 printf(
-                        "Cache description invalid. Capacity and block size must be "
-                        "between 2^0 and 2^25. Associativity must be "
-                        "non-zero.\nExiting...\n");
+                        "Cache description invalid. Capacity must be between 2^0 "
+                        "and 2^%d, block size between 2^0 and 2^25. Associativity "
+                        "must be positive.\nExiting...\n", MAX_LOG_CAPACITY);
                 suggest_help();
                 exit(1);
             }
@@ -120,6 +139,24 @@ int parse_args(char **args, int num_args, simulator_t *sim) {
             sim->trace = args[i++];
         }
 
+        // -merge ts|rr|skew 1000
+        if (strcmp(arg, "-merge") == 0 || strcmp(arg, "-m") == 0) {
+            char *policy = args[i++];
+            if (strcmp(policy, "ts") == 0)
+                sim->interleave = INTERLEAVE_TIMESTAMP;
+            else if (strcmp(policy, "rr") == 0)
+                sim->interleave = INTERLEAVE_ROUND_ROBIN;
+            else if (strcmp(policy, "skew") == 0 && i < num_args) {
+                sim->interleave = INTERLEAVE_SKEW;
+                sim->skew = strtoul(args[i++], NULL, 10);
+            }
+            else {
+                printf("unsupported merge policy.\nExiting....\n");
+                suggest_help();
+                exit(1);
+            }
+        }
+
         // -lru_on_invalidate
         if (strcmp(arg, "-lru_on_invalidate") == 0 || strcmp(arg, "-i") == 0) {
             sim->lru_on_invalidate_f = true;
@@ -130,6 +167,112 @@ int parse_args(char **args, int num_args, simulator_t *sim) {
             sim->limit_insn_f = true;
             sim->insn_limit = atoi(args[i++]);
         }
+
+        // -sockets 0,0,1,1
+        if (strcmp(arg, "-sockets") == 0 || strcmp(arg, "-S") == 0) {
+            sim->socket_map = args[i++];
+        }
+
+        // -home_interleave 12
+        if (strcmp(arg, "-home_interleave") == 0 || strcmp(arg, "-H") == 0) {
+            sim->home_interleave_bit = atoi(args[i++]);
+            if (sim->home_interleave_bit < 0 || sim->home_interleave_bit >= ADDRESS_SIZE) {
+                printf("Home interleave must be between 2^0 and 2^%d.\nExiting...\n",
+                        ADDRESS_SIZE - 1);
+                suggest_help();
+                exit(1);
+            }
+        }
+
+        // -profile results/prof/trace.1t.long
+        if (strcmp(arg, "-profile") == 0 || strcmp(arg, "-P") == 0) {
+            sim->profile = args[i++];
+        }
+
+        // -window 10000
+        if (strcmp(arg, "-window") == 0 || strcmp(arg, "-W") == 0) {
+            sim->profile_window = atol(args[i++]);
+            if (sim->profile_window <= 0) {
+                printf("Working set window must be positive.\nExiting...\n");
+                suggest_help();
+                exit(1);
+            }
+        }
+
+        // -self_profile
+        if (strcmp(arg, "-self_profile") == 0 || strcmp(arg, "-x") == 0) {
+            sim->self_profile = make_self_profile();
+        }
+
+        // -victim 8
+        if (strcmp(arg, "-victim") == 0 || strcmp(arg, "-V") == 0) {
+            sim->n_victim = atoi(args[i++]);
+            if (sim->n_victim <= 0) {
+                printf("Victim cache size must be positive.\nExiting...\n");
+                suggest_help();
+                exit(1);
+            }
+        }
+
+        // -snoop_filter
+        if (strcmp(arg, "-snoop_filter") == 0 || strcmp(arg, "-F") == 0) {
+            sim->snoop_filter_f = true;
+        }
+
+        // -tlb 64 4 4k
+        if (strcmp(arg, "-tlb") == 0 || strcmp(arg, "-T") == 0) {
+            if (i + 3 > num_args) {
+                printf("TLB description incomplete. Entries, associativity and "
+                        "page size must be specified.\nExiting...\n");
+                suggest_help();
+                exit(1);
+            }
+            sim->tlb_entries = atoi(args[i++]);
+            sim->tlb_assoc = atoi(args[i++]);
+            char *page = args[i++];
+            if (strcmp(page, "4k") == 0)
+                sim->tlb_page_bit = 12;
+            else if (strcmp(page, "2m") == 0)
+                sim->tlb_page_bit = 21;
+            else if (strcmp(page, "1g") == 0)
+                sim->tlb_page_bit = 30;
+            else
+                sim->tlb_page_bit = -1;
+            if (sim->tlb_page_bit < 0 || sim->tlb_entries <= 0 || sim->tlb_assoc <= 0 ||
+                    sim->tlb_entries % sim->tlb_assoc != 0) {
+                printf("TLB description invalid. Entries must be a positive multiple of "
+                        "the associativity, and the page size one of 4k, 2m, 1g.\nExiting...\n");
+                suggest_help();
+                exit(1);
+            }
+        }
+
+        // -mshr 8 100
+        if (strcmp(arg, "-mshr") == 0 || strcmp(arg, "-M") == 0) {
+            if (i + 2 > num_args) {
+                printf("MSHR description incomplete. Count and miss latency "
+                        "must be specified.\nExiting...\n");
+                suggest_help();
+                exit(1);
+            }
+            sim->n_mshr = atoi(args[i++]);
+            sim->miss_latency = atoi(args[i++]);
+            if (sim->n_mshr <= 0 || sim->miss_latency <= 0) {
+                printf("MSHR count and miss latency must be positive.\nExiting...\n");
+                suggest_help();
+                exit(1);
+            }
+        }
+
+        // -filter trace.1t.long.l1miss.txt
+        if (strcmp(arg, "-filter") == 0 || strcmp(arg, "-f") == 0) {
+            sim->filter_trace = args[i++];
+        }
+
+        // -result_store results/store
+        if (strcmp(arg, "-result_store") == 0 || strcmp(arg, "-r") == 0) {
+            sim->result_store_dir = args[i++];
+        }
     }
 
     if (!cache_specified) {
@@ -148,6 +291,26 @@ int main(int argc, char *argv[]) {
         sim->cache = malloc(sim->n_core * sizeof(cache_t*));
         for (int i = 0; i < sim->n_core; i++){
             sim->cache[i] = make_cache(capacity, block_size, assoc, sim->protocol, sim->lru_on_invalidate_f);
+            if (sim->n_mshr > 0)
+                sim->cache[i]->mshr = make_mshr(sim->n_mshr, sim->miss_latency);
+            if (sim->n_victim > 0)
+                sim->cache[i]->victim = make_victim_cache(sim->n_victim);
+            if (sim->snoop_filter_f)
+                attach_snoop_filter(sim->cache[i]);
+            if (sim->tlb_entries > 0)
+                sim->cache[i]->tlb = make_tlb(sim->tlb_entries, sim->tlb_assoc, sim->tlb_page_bit);
+        }
+        if (sim->profile != NULL)
+            sim->profiler = make_reuse_profiler(sim->n_core, block_size, sim->profile_window);
+        if (sim->socket_map != NULL) {
+            sim->topology = make_topology(sim->socket_map, sim->n_core,
+                    sim->home_interleave_bit, block_size);
+            if (sim->topology == NULL) {
+                printf("Socket map \'%s\' must name a socket for each of the %d cores.\nExiting...\n",
+                        sim->socket_map, sim->n_core);
+                suggest_help();
+                exit(1);
+            }
         }
         print_simulator_header(sim);
         process_trace(sim);  // this is still where the action takes place
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+
+#include "mshr.h"
+
+mshr_t *make_mshr(int n_entry, int miss_latency) {
+  mshr_t *mshr = malloc(sizeof(mshr_t));
+  mshr->n_entry = n_entry;
+  mshr->miss_latency = miss_latency;
+  mshr->entries = calloc(n_entry, sizeof(mshr_entry_t));
+  mshr->n_outstanding = 0;
+  mshr->cycle = 0;
+
+  mshr->stats.n_alloc = 0;
+  mshr->stats.n_merges = 0;
+  mshr->stats.n_full_stalls = 0;
+  mshr->stats.stall_cycles = 0;
+  mshr->stats.n_snoop_inval = 0;
+  mshr->stats.occupancy_sum = 0;
+  mshr->stats.max_occupancy = 0;
+  mshr->stats.n_accesses = 0;
+
+  return mshr;
+}
+
+void free_mshr(mshr_t *mshr) {
+  free(mshr->entries);
+  free(mshr);
+}
+
+/* Frees every entry whose fill has arrived by the current cycle. */
+void retire_fills(mshr_t *mshr) {
+  for (int i = 0; i < mshr->n_entry; i++) {
+    if (mshr->entries[i].valid && mshr->entries[i].fill_cycle <= mshr->cycle) {
+      mshr->entries[i].valid = false;
+      mshr->n_outstanding--;
+    }
+  }
+}
+
+/* Returns the in-flight fill of block_addr that new accesses may still
+ * merge into, if any. */
+mshr_entry_t *find_pending(mshr_t *mshr, unsigned long block_addr) {
+  for (int i = 0; i < mshr->n_entry; i++) {
+    mshr_entry_t *entry = &mshr->entries[i];
+    if (entry->valid && entry->mergeable && entry->block_addr == block_addr)
+      return entry;
+  }
+  return NULL;
+}
+
+/* Stalls the core until the earliest outstanding fill arrives. */
+void stall_for_entry(mshr_t *mshr) {
+  long earliest = -1;
+  for (int i = 0; i < mshr->n_entry; i++) {
+    if (mshr->entries[i].valid && (earliest < 0 || mshr->entries[i].fill_cycle < earliest))
+      earliest = mshr->entries[i].fill_cycle;
+  }
+  mshr->stats.n_full_stalls++;
+  mshr->stats.stall_cycles += earliest - mshr->cycle;
+  mshr->cycle = earliest;
+  retire_fills(mshr);
+}
+
+/* Accounts one access of this core. hit_f is the result of access_cache;
+ * a "hit" on a block whose fill is still in flight is a secondary miss. */
+void mshr_access(mshr_t *mshr, unsigned long block_addr, bool hit_f) {
+  mshr->cycle++;
+  retire_fills(mshr);
+
+  mshr_entry_t *pending = find_pending(mshr, block_addr);
+  if (pending != NULL) {
+    mshr->stats.n_merges++;
+  }
+  else if (!hit_f) {
+    if (mshr->n_outstanding == mshr->n_entry)
+      stall_for_entry(mshr);
+    for (int i = 0; i < mshr->n_entry; i++) {
+      if (!mshr->entries[i].valid) {
+        mshr->entries[i].block_addr = block_addr;
+        mshr->entries[i].fill_cycle = mshr->cycle + mshr->miss_latency;
+        mshr->entries[i].valid = true;
+        mshr->entries[i].mergeable = true;
+        break;
+      }
+    }
+    mshr->n_outstanding++;
+    mshr->stats.n_alloc++;
+  }
+
+  mshr->stats.n_accesses++;
+  mshr->stats.occupancy_sum += mshr->n_outstanding;
+  if (mshr->n_outstanding > mshr->stats.max_occupancy)
+    mshr->stats.max_occupancy = mshr->n_outstanding;
+}
+
+/* A remote miss for block_addr was snooped. If it invalidates a fill this
+ * core still has in flight, later accesses can't merge into that fill and
+ * must miss again once the (already invalidated) data arrives. */
+void mshr_snoop(mshr_t *mshr, unsigned long block_addr, bool invalidate_f) {
+  if (!invalidate_f)
+    return;
+  mshr_entry_t *pending = find_pending(mshr, block_addr);
+  if (pending != NULL && pending->fill_cycle > mshr->cycle) {
+    pending->mergeable = false;
+    mshr->stats.n_snoop_inval++;
+  }
+}
+
+/* Cycle the core is done, including draining its outstanding fills. */
+long mshr_finish_cycle(mshr_t *mshr) {
+  long finish = mshr->cycle;
+  for (int i = 0; i < mshr->n_entry; i++) {
+    if (mshr->entries[i].valid && mshr->entries[i].fill_cycle > finish)
+      finish = mshr->entries[i].fill_cycle;
+  }
+  return finish;
+}
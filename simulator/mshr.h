@@ -0,0 +1,47 @@
+#ifndef __MSHR_H
+#define __MSHR_H
+
+#include <stdbool.h>
+
+/* Miss status holding registers for one core.
+ *
+ * The cache model itself stays functional (a miss installs the line right
+ * away); the MSHRs add timing on top of it. Every trace record takes one
+ * cycle on its core, and a miss holds an MSHR for miss_latency cycles.
+ * Accesses to a block whose fill is still outstanding merge into that MSHR,
+ * and a miss with every MSHR busy stalls the core until one frees up.
+ */
+typedef struct {
+  unsigned long block_addr;
+  long fill_cycle;   // cycle the fill arrives and the entry frees up
+  bool valid;
+  bool mergeable;    // cleared when a remote miss invalidates the pending fill
+} mshr_entry_t;
+
+typedef struct {
+  long n_alloc;          // primary misses
+  long n_merges;         // secondary misses merged into a pending fill
+  long n_full_stalls;    // misses that found every MSHR busy
+  long stall_cycles;     // cycles lost to those stalls
+  long n_snoop_inval;    // pending fills invalidated by a remote miss
+  long occupancy_sum;    // outstanding misses summed over every access
+  int max_occupancy;
+  long n_accesses;
+} mshr_stats_t;
+
+typedef struct {
+  int n_entry;
+  int miss_latency;  // in cycles
+  mshr_entry_t *entries;
+  int n_outstanding;
+  long cycle;        // this core's clock
+  mshr_stats_t stats;
+} mshr_t;
+
+mshr_t *make_mshr(int n_entry, int miss_latency);
+void free_mshr(mshr_t *mshr);
+void mshr_access(mshr_t *mshr, unsigned long block_addr, bool hit_f);
+void mshr_snoop(mshr_t *mshr, unsigned long block_addr, bool invalidate_f);
+long mshr_finish_cycle(mshr_t *mshr);
+
+#endif  // MSHR
@@ -6,20 +6,6 @@
 #include "print_helpers.h"
 
 
-/* fields you might want to have print */
-int print_set = 0;
-int print_way = 0;
-
-
-void log_set(int set) {
-  print_set = set;
-}
-
-void log_way(int way) {
-  print_way = way;
-}
-
-
 void print_simulator_header(simulator_t *sim) {
   printf("Cache Simulator\n");
   printf("----------------------------------\n");
@@ -34,30 +20,95 @@ void print_simulator_header(simulator_t *sim) {
   print_cache_config(sim->cache[0]); // caches must be identical, so [0] is fine
 }
 
-void print_stats(cache_stats_t *stats, int core) {
-  printf("%d.n_cpu_accesses \t%ld\n", core, stats->n_cpu_accesses);
-  printf("%d.n_loads \t\t%ld\n", core, stats->n_cpu_accesses - stats->n_stores);
-  printf("%d.n_stores \t\t%ld\n", core, stats->n_stores);
-  printf("%d.n_hits \t\t%ld\n", core, stats->n_hits);
-  printf("%d.n_misses \t\t%ld\n", core, stats->n_cpu_accesses - stats->n_hits);
-  printf("%d.hit_rate \t\t%.2f\n", core, stats->hit_rate * 100.0);
-  printf("%d.miss_rate \t\t%.2f\n", core, (1 - stats->hit_rate) * 100.0);
-  printf("%d.n_upgrade_miss \t%ld\n", core, stats->n_upgrade_miss);
-  printf("%d.n_bus_snoops \t%ld\n", core, stats->n_bus_snoops);
-  printf("%d.n_snoop_hits \t%ld\n", core, stats->n_snoop_hits);
-  printf("%d.n_writebacks \t%ld\n", core, stats->n_writebacks);
-  printf("Memory Traffic:\n");
-  printf("%d.B_written_bus_to_cache \t%ld\n", core, stats->B_bus_to_cache);
-  printf("%d.B_written_cache_to_bus_wb \t%ld\n", core, stats->B_cache_to_bus_wb);
-  printf("%d.B_written_cache_to_bus_wt \t%ld\n", core, stats->B_cache_to_bus_wt);
-  printf("%d.B_total_traffic_wb \t%ld\n", core, stats->B_total_traffic_wb);
-  printf("%d.B_total_traffic_wt \t%ld\n", core, stats->B_total_traffic_wt);
+void fprint_stats(FILE *out, cache_stats_t *stats, int core) {
+  fprintf(out, "%d.n_cpu_accesses \t%ld\n", core, stats->n_cpu_accesses);
+  fprintf(out, "%d.n_loads \t\t%ld\n", core, stats->n_cpu_accesses - stats->n_stores);
+  fprintf(out, "%d.n_stores \t\t%ld\n", core, stats->n_stores);
+  fprintf(out, "%d.n_hits \t\t%ld\n", core, stats->n_hits);
+  fprintf(out, "%d.n_misses \t\t%ld\n", core, stats->n_cpu_accesses - stats->n_hits);
+  fprintf(out, "%d.hit_rate \t\t%.2f\n", core, stats->hit_rate * 100.0);
+  fprintf(out, "%d.miss_rate \t\t%.2f\n", core, (1 - stats->hit_rate) * 100.0);
+  fprintf(out, "%d.n_upgrade_miss \t%ld\n", core, stats->n_upgrade_miss);
+  fprintf(out, "%d.n_bus_snoops \t%ld\n", core, stats->n_bus_snoops);
+  fprintf(out, "%d.n_snoop_hits \t%ld\n", core, stats->n_snoop_hits);
+  fprintf(out, "%d.n_writebacks \t%ld\n", core, stats->n_writebacks);
+  fprintf(out, "Memory Traffic:\n");
+  fprintf(out, "%d.B_written_bus_to_cache \t%ld\n", core, stats->B_bus_to_cache);
+  fprintf(out, "%d.B_written_cache_to_bus_wb \t%ld\n", core, stats->B_cache_to_bus_wb);
+  fprintf(out, "%d.B_written_cache_to_bus_wt \t%ld\n", core, stats->B_cache_to_bus_wt);
+  fprintf(out, "%d.B_total_traffic_wb \t%ld\n", core, stats->B_total_traffic_wb);
+  fprintf(out, "%d.B_total_traffic_wt \t%ld\n", core, stats->B_total_traffic_wt);
+
+}
+
+void fprint_mshr_stats(FILE *out, mshr_t *mshr, int block_size, int core) {
+  mshr_stats_t *stats = &mshr->stats;
+  long cycles = mshr_finish_cycle(mshr);
+  fprintf(out, "MSHRs (%d x %d cycles):\n", mshr->n_entry, mshr->miss_latency);
+  fprintf(out, "%d.n_cycles \t\t%ld\n", core, cycles);
+  fprintf(out, "%d.n_mshr_alloc \t%ld\n", core, stats->n_alloc);
+  fprintf(out, "%d.n_mshr_merges \t%ld\n", core, stats->n_merges);
+  fprintf(out, "%d.n_mshr_full_stalls \t%ld\n", core, stats->n_full_stalls);
+  fprintf(out, "%d.mshr_stall_cycles \t%ld\n", core, stats->stall_cycles);
+  fprintf(out, "%d.n_mshr_snoop_inval \t%ld\n", core, stats->n_snoop_inval);
+  fprintf(out, "%d.avg_mshr_occupancy \t%.2f\n", core,
+          stats->n_accesses ? stats->occupancy_sum / (double)stats->n_accesses : 0.0);
+  fprintf(out, "%d.max_mshr_occupancy \t%d\n", core, stats->max_occupancy);
+  fprintf(out, "%d.fill_B_per_cycle \t%.2f\n", core,
+          cycles ? stats->n_alloc * block_size / (double)cycles : 0.0);
+}
+
+void fprint_victim_stats(FILE *out, cache_t *cache, int core) {
+  victim_cache_t *victim = cache->victim;
+  fprintf(out, "Victim cache (%d entries):\n", victim->n_entry);
+  fprintf(out, "%d.n_victim_lookups \t%ld\n", core, victim->n_lookups);
+  fprintf(out, "%d.n_victim_hits \t%ld\n", core, victim->n_hits);
+  fprintf(out, "%d.victim_hit_rate \t%.2f\n", core,
+          victim->n_lookups ? victim->n_hits * 100.0 / victim->n_lookups : 0.0);
+  fprintf(out, "%d.n_victim_snoop_hits \t%ld\n", core, victim->n_snoop_hits);
+}
+
+void fprint_snoop_filter_stats(FILE *out, cache_t *cache, int core) {
+  snoop_filter_t *filter = cache->snoop_filter;
+  fprintf(out, "Snoop filter:\n");
+  fprintf(out, "%d.n_filter_snoops \t%ld\n", core, filter->n_snoops);
+  fprintf(out, "%d.n_snoops_filtered \t%ld\n", core, filter->n_filtered);
+  fprintf(out, "%d.snoop_filter_rate \t%.2f\n", core,
+          filter->n_snoops ? filter->n_filtered * 100.0 / filter->n_snoops : 0.0);
+}
+
+void fprint_tlb_stats(FILE *out, cache_t *cache, int core) {
+  tlb_t *tlb = cache->tlb;
+  fprintf(out, "TLB (%d entries, %d-way, %ld KB pages):\n", tlb->n_entry, tlb->assoc,
+          (1L << tlb->page_bit) / 1024);
+  fprintf(out, "%d.n_tlb_lookups \t%ld\n", core, tlb->n_lookups);
+  fprintf(out, "%d.n_tlb_hits \t\t%ld\n", core, tlb->n_hits);
+  fprintf(out, "%d.tlb_hit_rate \t%.2f\n", core,
+          tlb->n_lookups ? tlb->n_hits * 100.0 / tlb->n_lookups : 0.0);
+  fprintf(out, "%d.n_walk_accesses \t%ld\n", core, tlb->n_walk_accesses);
+  fprintf(out, "%d.n_walk_misses \t%ld\n", core, tlb->n_walk_misses);
+  fprintf(out, "%d.B_walk_bus_to_cache \t%ld\n", core, tlb->n_walk_misses * cache->block_size);
+}
 
+/* Everything reported for one core at the end of a run: the cache stats
+ * and those of whichever optional structures are attached to it. */
+void fprint_core_results(FILE *out, simulator_t *sim, int core) {
+  cache_t *cache = sim->cache[core];
+  fprintf(out, "    *** Results for Core %d ***\n", core);
+  fprint_stats(out, cache->stats, core);
+  if (cache->mshr != NULL)
+    fprint_mshr_stats(out, cache->mshr, cache->block_size, core);
+  if (cache->victim != NULL)
+    fprint_victim_stats(out, cache, core);
+  if (cache->snoop_filter != NULL)
+    fprint_snoop_filter_stats(out, cache, core);
+  if (cache->tlb != NULL)
+    fprint_tlb_stats(out, cache, core);
 }
 
 void print_cache_config(cache_t *cache) {
   printf(" *** Cache Configuration *** \n");
-  printf("capacity   \t\t%5d B\n", cache->capacity);
+  printf("capacity   \t\t%5ld B\n", cache->capacity);
   printf("block_size \t\t%5d B\n", cache->block_size);
   printf("associativity \t\t");
   if (cache->n_index_bit == 0)
@@ -65,8 +116,8 @@ void print_cache_config(cache_t *cache) {
   else
     printf("%d-way\n", cache->assoc);
   
-  printf("n_set \t\t\t%d\n",cache->n_set);
-  printf("n_cache_line \t%d\n", cache->n_cache_line);
+  printf("n_set \t\t\t%ld\n",cache->n_set);
+  printf("n_cache_line \t%ld\n", cache->n_cache_line);
   printf("tag: %d, index: %d, offset: %d\n", cache->n_tag_bit, cache->n_index_bit, cache->n_offset_bit);
   printf("Coherence Protocol: \t%s\n", cache->protocol == NONE ? "none" : cache->protocol == VI ? "vi" : "msi");
   printf("lru_on_invalidate_f: \t%s\n", cache->lru_on_invalidate_f ? "true" : "false");
@@ -88,9 +139,11 @@ char state_to_char(enum state_t state) {
 
 
 void print_insn_info(simulator_t *sim, int core, char cmd, unsigned long addr, bool hit_f) {
-  printf("%d %c %lx --> {blk: %lx} %s ==> [set:%4d][way:%d](%c,%s)\n", core, cmd,
-	 addr, get_cache_block_addr(sim->cache[core], addr), hit_f ? " hit" : "miss",
-	 print_set, print_way, state_to_char(sim->cache[core]->lines[print_set][print_way].state),
-	 sim->cache[core]->lines[print_set][print_way].dirty_f ? "dirty" : "clean");
+  cache_t *cache = sim->cache[core];
+  cache_line_t *line = &cache->lines[cache->print_set][cache->print_way];
+  printf("%d %c %lx --> {blk: %lx} %s ==> [set:%4ld][way:%d](%c,%s)\n", core, cmd,
+	 addr, get_cache_block_addr(cache, addr), hit_f ? " hit" : "miss",
+	 cache->print_set, cache->print_way, state_to_char(line->state),
+	 line->dirty_f ? "dirty" : "clean");
 }
 
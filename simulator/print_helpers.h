@@ -2,20 +2,24 @@
 #define __PRINT_HELPERS_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "cache.h"
 #include "cache_stats.h"
 #include "simulator.h"
 
 /* Functions for verbose mode logging */
-void log_set(int set);
-void log_way(int way);
 
 void print_simulator_header(simulator_t *sim);
 
 void print_insn_info(simulator_t *sim, int core, char cmd, unsigned long address, bool hit_f);
 void print_trace_stats(cache_stats_t *stats);
 
-void print_stats(cache_stats_t *stats, int core);
+void fprint_stats(FILE *out, cache_stats_t *stats, int core);
+void fprint_mshr_stats(FILE *out, mshr_t *mshr, int block_size, int core);
+void fprint_victim_stats(FILE *out, cache_t *cache, int core);
+void fprint_snoop_filter_stats(FILE *out, cache_t *cache, int core);
+void fprint_tlb_stats(FILE *out, cache_t *cache, int core);
+void fprint_core_results(FILE *out, simulator_t *sim, int core);
 
 char state_to_char(enum state_t state);
 
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "result_store.h"
+#include "print_helpers.h"
+
+/* key and config string of the run currently being simulated,
+ * filled in by result_store_lookup() and consumed by result_store_save() */
+unsigned long entry_key = 0;
+char *entry_config = NULL;
+
+/* Path of the current entry, malloc'ed. */
+char *entry_path(simulator_t *sim) {
+  char *path;
+  if (asprintf(&path, "%s/%016lx.out", sim->result_store_dir, entry_key) < 0)
+    return NULL;
+  return path;
+}
+
+/* Computes the key of this run and, if the store already holds it, prints
+ * the stored results and returns true. */
+bool result_store_lookup(simulator_t *sim, unsigned long trace_hash) {
+  cache_t *cache = sim->cache[0];  // caches must be identical, so [0] is fine
+  free(entry_config);
+  // sized to fit: a truncated config would alias other configs' keys
+  int len = asprintf(&entry_config,
+          "trace_hash=%016lx trace=%s protocol=%s n_core=%d capacity=%ld "
+          "block_size=%d assoc=%d lru_on_invalidate=%d limit=%d "
+          "interleave=%s skew=%lu mshr=%d miss_latency=%d "
+          "sockets=%s home_interleave=%d victim=%d snoop_filter=%d "
+          "tlb=%d/%d/%d version=%s",
+          trace_hash, sim->trace,
+          sim->protocol == NONE ? "none" : sim->protocol == VI ? "vi" : "msi",
+          sim->n_core, cache->capacity, cache->block_size, cache->assoc,
+          sim->lru_on_invalidate_f, sim->limit_insn_f ? sim->insn_limit : -1,
+          interleave_name(sim->interleave), sim->skew, sim->n_mshr,
+          sim->n_mshr ? sim->miss_latency : 0,
+          sim->socket_map ? sim->socket_map : "none",
+          sim->socket_map ? sim->home_interleave_bit : 0,
+          sim->n_victim, sim->snoop_filter_f, sim->tlb_entries, sim->tlb_assoc,
+          sim->tlb_entries ? sim->tlb_page_bit : 0, SIM_VERSION);
+  if (len < 0) {
+    printf("Unable to build the result store key\nExiting...\n");
+    exit(EXIT_FAILURE);
+  }
+  entry_key = fnv1a(FNV_OFFSET_BASIS, (unsigned char *)entry_config, len);
+
+  char *path = entry_path(sim);
+  FILE *f = (path != NULL) ? fopen(path, "r") : NULL;
+  free(path);
+  if (f == NULL)
+    return false;
+
+  printf("Loaded stored results %016lx\n", entry_key);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    fwrite(buf, 1, n, stdout);
+  fclose(f);
+  return true;
+}
+
+/* Records the results of the run set up by result_store_lookup(). The
+ * entry is written to a temporary file and renamed into place so
+ * concurrent sweeps never see a partial entry. */
+void result_store_save(simulator_t *sim, long total_insn) {
+  if (mkdir(sim->result_store_dir, 0755) != 0 && errno != EEXIST) {
+    printf("Unable to create result store \'%s\'\n", sim->result_store_dir);
+    return;
+  }
+
+  char *path = entry_path(sim), *tmp_path;
+  if (path == NULL || asprintf(&tmp_path, "%s.%d.tmp", path, getpid()) < 0) {
+    printf("Unable to write result store entry\n");
+    free(path);
+    return;
+  }
+  FILE *f = fopen(tmp_path, "w");
+  if (f == NULL) {
+    printf("Unable to write result store entry \'%s\'\n", path);
+    free(path);
+    free(tmp_path);
+    return;
+  }
+  fprintf(f, "Processed %ld lines.\n", total_insn);
+  for (int i = 0; i < sim->n_core; i++)
+    fprint_core_results(f, sim, i);
+  if (sim->topology != NULL)
+    fprint_topology_stats(f, sim->topology);
+  fclose(f);
+  rename(tmp_path, path);
+  free(path);
+  free(tmp_path);
+
+  if (asprintf(&path, "%s/index.txt", sim->result_store_dir) < 0)
+    return;
+  f = fopen(path, "a");
+  free(path);
+  if (f != NULL) {
+    fprintf(f, "%016lx\t%s\n", entry_key, entry_config);
+    fclose(f);
+  }
+}
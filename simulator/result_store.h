@@ -0,0 +1,18 @@
+#ifndef __RESULT_STORE_H
+#define __RESULT_STORE_H
+
+#include <stdbool.h>
+#include "simulator.h"
+#include "fnv_hash.h"
+
+/* Persistent on-disk memo of simulation results.
+ *
+ * Each entry is keyed by a hash of the trace file contents plus the full
+ * simulator configuration (see SIM_VERSION), and stores the text printed
+ * after "Processing trace..." so a repeat run can replay it verbatim.
+ * <dir>/index.txt lists one "<key>\t<config>" line per stored entry.
+ */
+bool result_store_lookup(simulator_t *sim, unsigned long trace_hash);
+void result_store_save(simulator_t *sim, long total_insn);
+
+#endif  // RESULT_STORE
@@ -0,0 +1,93 @@
+#!/usr/bin/python3
+
+# Bulk queries against the result store written by `./p5 -r <dir>`.
+# Entries are matched on the same config string the simulator builds in
+# result_store.c, so a changed trace or SIM_VERSION never matches.
+
+import os
+import re
+
+FNV_OFFSET_BASIS = 0xcbf29ce484222325
+FNV_PRIME = 0x100000001b3
+MASK = (1 << 64) - 1
+
+_trace_hashes = {}
+
+
+def sim_version():
+    for line in open(os.path.join(os.path.dirname(__file__) or '.', 'simulator.h')):
+        m = re.match(r'#define SIM_VERSION "(.*)"', line)
+        if m:
+            return m.group(1)
+    return ''
+
+
+def hash_trace(trace, core, interleave):
+    # per-core traces are hashed back to back in core order
+    files = [trace] if interleave == 'file' else [trace % i for i in range(core)]
+    key = tuple(files)
+    if key not in _trace_hashes:
+        h = FNV_OFFSET_BASIS
+        for name in files:
+            with open('trace/' + name, 'rb') as f:
+                for byte in f.read():
+                    h = ((h ^ byte) * FNV_PRIME) & MASK
+        _trace_hashes[key] = h
+    return _trace_hashes[key]
+
+
+def config_string(trace, protocol, core, cap, bsize, assoc, lru=False, limit=-1,
+                  interleave='file', skew=0, mshr=0, miss_latency=0,
+                  sockets=None, home_interleave=12, victim=0, snoop_filter=False,
+                  tlb=None):
+    return ('trace_hash=%016x trace=%s protocol=%s n_core=%d capacity=%d '
+            'block_size=%d assoc=%d lru_on_invalidate=%d limit=%d '
+            'interleave=%s skew=%d mshr=%d miss_latency=%d '
+            'sockets=%s home_interleave=%d victim=%d snoop_filter=%d '
+            'tlb=%d/%d/%d version=%s') % (
+            hash_trace(trace, core, interleave), trace, protocol, core, 2**cap,
+            2**bsize, assoc, lru, limit, interleave, skew, mshr,
+            miss_latency if mshr else 0, sockets or 'none',
+            home_interleave if sockets else 0, victim, snoop_filter,
+            # tlb is (entries, assoc, log2 page size)
+            *(tlb or (0, 0, 0)), sim_version())
+
+
+def load_index(store):
+    index = {}
+    path = os.path.join(store, 'index.txt')
+    if os.path.exists(path):
+        for line in open(path):
+            key, config = line.rstrip('\n').split('\t', 1)
+            index[config] = key
+    return index
+
+
+def read_entry(store, key):
+    stats = {}
+    for line in open(os.path.join(store, key + '.out')):
+        fields = line.split()
+        if len(fields) != 2:
+            continue
+        if line[0].isdigit() and '.' in fields[0]:
+            core, name = fields[0].split('.', 1)
+            stats.setdefault(int(core), {})[name] = float(fields[1])
+        elif re.match(r'(s\d+\.)?[nB]_', fields[0]):
+            # interconnect stats of -S runs, per socket (s<i>.) and global
+            stats.setdefault('topology', {})[fields[0]] = float(fields[1])
+    return stats
+
+
+def query(store, configs):
+    """Look up many configs at once. Each config is a tuple of the
+    config_string() arguments (log2 cap and bsize, as on the command line).
+    Returns {config: {core: {stat: value}}} for the configs that are stored;
+    missing configs are left out. Runs with sockets also have a 'topology'
+    entry holding the interconnect stats, e.g. 's0.n_bus_msgs'."""
+    index = load_index(store)
+    results = {}
+    for c in configs:
+        key = index.get(config_string(*c))
+        if key is not None:
+            results[c] = read_entry(store, key)
+    return results
@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reuse_profile.h"
+
+#define MIN_TREE_SIZE 1024
+#define MIN_TABLE_SIZE 1024
+
+reuse_profile_t *make_reuse_profile(long window) {
+  reuse_profile_t *profile = malloc(sizeof(reuse_profile_t));
+  profile->table_size = MIN_TABLE_SIZE;
+  profile->table = calloc(profile->table_size, sizeof(reuse_entry_t));
+  profile->n_block = 0;
+
+  profile->tree_size = MIN_TREE_SIZE;
+  profile->tree = calloc(profile->tree_size + 1, sizeof(long));
+  profile->now = 0;
+
+  memset(profile->hist, 0, sizeof(profile->hist));
+  profile->n_cold = 0;
+
+  profile->n_access = 0;
+  profile->window_blocks = malloc(window * sizeof(unsigned long));
+  profile->window_distinct = 0;
+  profile->wss_cap = 64;
+  profile->wss = malloc(profile->wss_cap * sizeof(long));
+  profile->n_sample = 0;
+  return profile;
+}
+
+reuse_profiler_t *make_reuse_profiler(int n_core, int block_size, long window) {
+  reuse_profiler_t *profiler = malloc(sizeof(reuse_profiler_t));
+  profiler->n_core = n_core;
+  profiler->block_size = block_size;
+  profiler->profiles = malloc((n_core + 1) * sizeof(reuse_profile_t*));
+  for (int i = 0; i <= n_core; i++)
+    profiler->profiles[i] = make_reuse_profile(window);
+  profiler->window = window;
+  profiler->sample_step = (window >= WSS_SAMPLES_PER_WINDOW) ? window / WSS_SAMPLES_PER_WINDOW : 1;
+  return profiler;
+}
+
+/* Fenwick tree over stream positions, 0-based on the outside. */
+void tree_add(reuse_profile_t *profile, long pos, long delta) {
+  for (long i = pos + 1; i <= profile->tree_size; i += i & -i)
+    profile->tree[i] += delta;
+}
+
+// number of markers at positions [0, pos]
+long tree_sum(reuse_profile_t *profile, long pos) {
+  long sum = 0;
+  for (long i = pos + 1; i > 0; i -= i & -i)
+    sum += profile->tree[i];
+  return sum;
+}
+
+unsigned long hash_block(unsigned long block) {
+  block ^= block >> 33;
+  block *= 0xff51afd7ed558ccdUL;
+  block ^= block >> 33;
+  return block;
+}
+
+reuse_entry_t *find_entry(reuse_entry_t *table, long table_size, unsigned long block) {
+  unsigned long i = hash_block(block) & (table_size - 1);
+  while (table[i].used && table[i].block != block)
+    i = (i + 1) & (table_size - 1);
+  return &table[i];
+}
+
+void grow_table(reuse_profile_t *profile) {
+  long old_size = profile->table_size;
+  reuse_entry_t *old = profile->table;
+  profile->table_size *= 2;
+  profile->table = calloc(profile->table_size, sizeof(reuse_entry_t));
+  for (long i = 0; i < old_size; i++) {
+    if (old[i].used)
+      *find_entry(profile->table, profile->table_size, old[i].block) = old[i];
+  }
+  free(old);
+}
+
+int compare_last(const void *a, const void *b) {
+  long x = (*(reuse_entry_t **)a)->last, y = (*(reuse_entry_t **)b)->last;
+  return (x > y) - (x < y);
+}
+
+/* Renumbers the markers 0..n_block-1 in access order and rebuilds the tree
+ * with room for as many accesses again. Distances only depend on the order
+ * of the markers, so they are unaffected. */
+void compact_tree(reuse_profile_t *profile) {
+  reuse_entry_t **live = malloc(profile->n_block * sizeof(reuse_entry_t*));
+  long n = 0;
+  for (long i = 0; i < profile->table_size; i++) {
+    if (profile->table[i].used)
+      live[n++] = &profile->table[i];
+  }
+  qsort(live, n, sizeof(reuse_entry_t*), compare_last);
+
+  profile->tree_size = (2 * n > MIN_TREE_SIZE) ? 2 * n : MIN_TREE_SIZE;
+  free(profile->tree);
+  profile->tree = calloc(profile->tree_size + 1, sizeof(long));
+  for (long i = 0; i < n; i++) {
+    live[i]->last = i;
+    tree_add(profile, i, 1);
+  }
+  profile->now = n;
+  free(live);
+}
+
+int reuse_bucket(long distance) {
+  int bucket = 0;
+  while (distance > 0) {
+    bucket++;
+    distance >>= 1;
+  }
+  return bucket;
+}
+
+/* Slides the stream's working-set window past its oldest access: that
+ * block leaves the window unless it was accessed again since. */
+void expire_access(reuse_profile_t *profile, long window) {
+  long oldest = profile->n_access - window;
+  if (oldest < 0)
+    return;
+  unsigned long block = profile->window_blocks[oldest % window];
+  if (find_entry(profile->table, profile->table_size, block)->last_access == oldest)
+    profile->window_distinct--;
+}
+
+void take_sample(reuse_profile_t *profile) {
+  if (profile->n_sample == profile->wss_cap) {
+    profile->wss_cap *= 2;
+    profile->wss = realloc(profile->wss, profile->wss_cap * sizeof(long));
+  }
+  profile->wss[profile->n_sample++] = profile->window_distinct;
+}
+
+void record_access(reuse_profile_t *profile, unsigned long block, long window, long sample_step) {
+  if (profile->now == profile->tree_size)
+    compact_tree(profile);
+  expire_access(profile, window);
+
+  reuse_entry_t *entry = find_entry(profile->table, profile->table_size, block);
+  if (entry->used) {
+    long distance = tree_sum(profile, profile->now - 1) - tree_sum(profile, entry->last);
+    profile->hist[reuse_bucket(distance)]++;
+    tree_add(profile, entry->last, -1);
+    if (entry->last_access <= profile->n_access - window)
+      profile->window_distinct++;
+  } else {
+    entry->used = true;
+    entry->block = block;
+    profile->n_block++;
+    profile->n_cold++;
+    profile->window_distinct++;
+  }
+  entry->last = profile->now;
+  entry->last_access = profile->n_access;
+  tree_add(profile, profile->now, 1);
+  profile->now++;
+
+  profile->window_blocks[profile->n_access % window] = block;
+  profile->n_access++;
+  if (profile->n_access % sample_step == 0)
+    take_sample(profile);
+
+  if (2 * profile->n_block > profile->table_size)
+    grow_table(profile);
+}
+
+/* Records one access of core to block_addr in its core's profile and the
+ * global one. */
+void profile_access(reuse_profiler_t *profiler, int core, unsigned long block_addr) {
+  record_access(profiler->profiles[core], block_addr, profiler->window, profiler->sample_step);
+  record_access(profiler->profiles[profiler->n_core], block_addr, profiler->window,
+          profiler->sample_step);
+}
+
+void print_profile_header(FILE *out, reuse_profiler_t *profiler, const char *first) {
+  fprintf(out, "%s", first);
+  for (int i = 0; i < profiler->n_core; i++)
+    fprintf(out, "\tcore%d", i);
+  fprintf(out, "\tall\n");
+}
+
+/* Writes <prefix>.reuse.txt (reuse distance histogram, one column per core
+ * plus the whole trace) and <prefix>.wss.txt (sliding working-set samples,
+ * row r taken after (r + 1) * sample_step accesses of each stream; streams
+ * that ended earlier print "-"). */
+bool write_reuse_profile(reuse_profiler_t *profiler, const char *prefix) {
+  char *path = malloc(strlen(prefix) + 16);
+  reuse_profile_t **profiles = profiler->profiles;
+  int n = profiler->n_core + 1;
+
+  sprintf(path, "%s.reuse.txt", prefix);
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    free(path);
+    return false;
+  }
+  int last_bucket = 0;
+  for (int b = 0; b < N_REUSE_BUCKET; b++) {
+    if (profiles[profiler->n_core]->hist[b])
+      last_bucket = b;
+  }
+  fprintf(out, "# reuse distance in distinct %dB blocks, bucket [lo, hi)\n", profiler->block_size);
+  print_profile_header(out, profiler, "# lo\thi");
+  for (int b = 0; b <= last_bucket; b++) {
+    unsigned long lo = (b == 0) ? 0 : 1UL << (b - 1);
+    unsigned long hi = (b == 0) ? 1 : (b == 64) ? 0 : 1UL << b;
+    fprintf(out, "%lu\t%lu", lo, hi);
+    for (int i = 0; i < n; i++)
+      fprintf(out, "\t%ld", profiles[i]->hist[b]);
+    fprintf(out, "\n");
+  }
+  fprintf(out, "cold\t-");
+  for (int i = 0; i < n; i++)
+    fprintf(out, "\t%ld", profiles[i]->n_cold);
+  fprintf(out, "\n");
+  fclose(out);
+
+  long n_sample = 0;
+  for (int i = 0; i < n; i++) {
+    if (profiles[i]->n_sample > n_sample)
+      n_sample = profiles[i]->n_sample;
+  }
+
+  sprintf(path, "%s.wss.txt", prefix);
+  out = fopen(path, "w");
+  if (out == NULL) {
+    free(path);
+    return false;
+  }
+  fprintf(out, "# distinct %dB blocks in the last %ld accesses of each stream\n"
+          "# (fewer while a stream is shorter than the window)\n",
+          profiler->block_size, profiler->window);
+  print_profile_header(out, profiler, "# end");
+  for (long r = 0; r < n_sample; r++) {
+    fprintf(out, "%ld", (r + 1) * profiler->sample_step);
+    for (int i = 0; i < n; i++) {
+      if (r < profiles[i]->n_sample)
+        fprintf(out, "\t%ld", profiles[i]->wss[r]);
+      else
+        fprintf(out, "\t-");
+    }
+    fprintf(out, "\n");
+  }
+  fclose(out);
+  free(path);
+  return true;
+}
@@ -0,0 +1,64 @@
+#ifndef __REUSE_PROFILE_H
+#define __REUSE_PROFILE_H
+
+#include <stdbool.h>
+
+// log2 buckets: bucket 0 holds distance 0, bucket k holds [2^(k-1), 2^k)
+#define N_REUSE_BUCKET 65
+
+typedef struct {
+  unsigned long block;
+  long last;         // tree position of the previous access in this stream
+  long last_access;  // access number of the previous access in this stream
+  bool used;
+} reuse_entry_t;
+
+/* Reuse distance of one access stream (a core, or the whole trace).
+ *
+ * The distance of an access is the number of distinct blocks touched since
+ * the previous access to the same block. Every block keeps a marker at the
+ * position of its latest access in a Fenwick tree, so the distance is a
+ * prefix-sum difference, O(log n) per access. When the tree fills up, the
+ * markers are renumbered densely, so memory stays proportional to the
+ * footprint rather than the trace length.
+ */
+typedef struct {
+  reuse_entry_t *table;  // open addressing, keyed by block address
+  long table_size;
+  long n_block;
+
+  long *tree;
+  long tree_size;
+  long now;
+
+  long hist[N_REUSE_BUCKET];
+  long n_cold;
+
+  long n_access;
+  unsigned long *window_blocks;  // ring of the blocks of the last window accesses
+  long window_distinct;          // distinct blocks in the last window accesses
+  long *wss;                     // window_distinct at every sample
+  long n_sample;
+  long wss_cap;
+} reuse_profile_t;
+
+// working-set samples taken per window length of accesses
+#define WSS_SAMPLES_PER_WINDOW 4
+
+/* Per-core and global profiles for a run, plus the working-set windows.
+ * The working set slides over each stream's own accesses: every
+ * window / WSS_SAMPLES_PER_WINDOW accesses of a stream, it samples the
+ * distinct blocks of that stream's last window accesses. */
+typedef struct {
+  int n_core;
+  int block_size;
+  reuse_profile_t **profiles;  // [0, n_core) per core, [n_core] global
+  long window;                 // accesses per working-set window
+  long sample_step;            // accesses between working-set samples
+} reuse_profiler_t;
+
+reuse_profiler_t *make_reuse_profiler(int n_core, int block_size, long window);
+void profile_access(reuse_profiler_t *profiler, int core, unsigned long block_addr);
+bool write_reuse_profile(reuse_profiler_t *profiler, const char *prefix);
+
+#endif  // REUSE_PROFILE
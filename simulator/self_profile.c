@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "self_profile.h"
+
+#define CALIBRATION_SWITCHES 1000
+
+const char *phase_names[N_PHASE] = { "parse", "access", "snoop", "stats" };
+
+#ifdef __linux__
+int open_counter(unsigned long config, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = (group_fd == -1);  // the leader starts the whole group
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+unsigned long rdpmc(unsigned int counter) {
+  unsigned int lo, hi;
+  __asm__ volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+  return lo | ((unsigned long)hi << 32);
+}
+
+/* Reads one counter from user space, following the seqlock protocol of
+ * perf_event_mmap_page. Returns false if the event isn't on a hardware
+ * counter right now, so the caller has to ask the kernel. */
+bool read_mmap_counter(struct perf_event_mmap_page *page, unsigned long *count) {
+  unsigned int seq;
+  long value;
+  do {
+    seq = page->lock;
+    __sync_synchronize();
+    unsigned int index = page->index;
+    if (!page->cap_user_rdpmc || index == 0)
+      return false;
+    long pmc = rdpmc(index - 1);
+    int shift = 64 - page->pmc_width;
+    value = page->offset + ((pmc << shift) >> shift);  // sign extend the width
+    __sync_synchronize();
+  } while (page->lock != seq);
+  *count = value;
+  return true;
+}
+#else
+bool read_mmap_counter(struct perf_event_mmap_page *page, unsigned long *count) {
+  return false;
+}
+#endif
+
+/* Maps each open counter's control page. rdpmc is only used when every
+ * counter allows it. */
+void map_counters(self_profile_t *prof) {
+  long page_size = sysconf(_SC_PAGESIZE);
+  prof->rdpmc_f = true;
+  for (int c = 0; c < N_HOST_COUNTER; c++) {
+    if (!prof->counter_f[c])
+      continue;
+    void *page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, prof->fd[c], 0);
+    if (page == MAP_FAILED) {
+      prof->rdpmc_f = false;
+      continue;
+    }
+    prof->mmap_page[c] = page;
+    if (!((struct perf_event_mmap_page *)page)->cap_user_rdpmc)
+      prof->rdpmc_f = false;
+  }
+}
+#endif
+
+/* Reads the group into now[], in the order the counters were opened. */
+void read_counters(self_profile_t *prof, unsigned long *now) {
+  memset(now, 0, N_HOST_COUNTER * sizeof(unsigned long));
+  if (prof->group_fd < 0)
+    return;
+#ifdef __linux__
+  if (prof->rdpmc_f) {
+    bool ok_f = true;
+    for (int c = 0; c < N_HOST_COUNTER && ok_f; c++) {
+      if (prof->counter_f[c])
+        ok_f = read_mmap_counter(prof->mmap_page[c], &now[c]);
+    }
+    if (ok_f)
+      return;
+  }
+#endif
+  unsigned long buf[1 + N_HOST_COUNTER];
+  if (read(prof->group_fd, buf, sizeof(buf)) <= 0)
+    return;
+  int n = 0;
+  for (int c = 0; c < N_HOST_COUNTER && n < (int)buf[0]; c++) {
+    if (prof->counter_f[c])
+      now[c] = buf[1 + n++];
+  }
+}
+
+unsigned long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* Measures the cost of a phase switch: back to back switches leave
+ * intervals that hold nothing but one switch each. */
+void calibrate(self_profile_t *prof) {
+  for (int i = 0; i <= CALIBRATION_SWITCHES; i++)
+    phase_switch(prof, PHASE_PARSE);
+  for (int c = 0; c < N_HOST_COUNTER; c++)
+    prof->overhead[c] = prof->total[PHASE_PARSE][c] / (double)CALIBRATION_SWITCHES;
+  prof->overhead_ns = prof->total_ns[PHASE_PARSE] / (double)CALIBRATION_SWITCHES;
+
+  memset(prof->total, 0, sizeof(prof->total));
+  memset(prof->total_ns, 0, sizeof(prof->total_ns));
+  memset(prof->n_interval, 0, sizeof(prof->n_interval));
+  prof->phase = PHASE_NONE;
+}
+
+self_profile_t *make_self_profile() {
+  self_profile_t *prof = calloc(1, sizeof(self_profile_t));
+  prof->group_fd = -1;
+  for (int c = 0; c < N_HOST_COUNTER; c++)
+    prof->fd[c] = -1;
+  prof->phase = PHASE_NONE;
+
+#ifdef __linux__
+  unsigned long configs[N_HOST_COUNTER] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+  };
+  prof->group_fd = open_counter(configs[HC_CYCLES], -1);
+  if (prof->group_fd >= 0) {
+    prof->fd[HC_CYCLES] = prof->group_fd;
+    prof->counter_f[HC_CYCLES] = true;
+    for (int c = HC_CYCLES + 1; c < N_HOST_COUNTER; c++) {
+      prof->fd[c] = open_counter(configs[c], prof->group_fd);
+      prof->counter_f[c] = prof->fd[c] >= 0;
+    }
+    map_counters(prof);
+    ioctl(prof->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(prof->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#endif
+  calibrate(prof);
+  return prof;
+}
+
+/* Charges everything since the last switch to the current phase, then
+ * enters the given one. */
+void phase_switch(self_profile_t *prof, enum phase_t phase) {
+  unsigned long now[N_HOST_COUNTER];
+  read_counters(prof, now);
+  unsigned long ns = now_ns();
+  if (prof->phase != PHASE_NONE) {
+    for (int c = 0; c < N_HOST_COUNTER; c++)
+      prof->total[prof->phase][c] += now[c] - prof->last[c];
+    prof->total_ns[prof->phase] += ns - prof->last_ns;
+    prof->n_interval[prof->phase]++;
+  }
+  if (phase == PHASE_STATS) {  // the trace loop is over
+    for (int c = 0; c < N_HOST_COUNTER; c++)
+      prof->loop[c] = now[c] - prof->loop_start[c];
+    prof->loop_ns = ns - prof->loop_start_ns;
+  }
+  memcpy(prof->last, now, sizeof(now));
+  prof->last_ns = ns;
+  prof->phase = phase;
+  prof->n_loop_switch++;
+}
+
+/* Switches phase within a sampled record; records in between samples run
+ * without instrumentation. */
+void sample_phase(self_profile_t *prof, enum phase_t phase) {
+  if (prof->phase != PHASE_NONE)
+    phase_switch(prof, phase);
+}
+
+/* Called once n_record records are done: ends the current sample, and
+ * starts the next one if the coming record is sampled. */
+void next_sample(self_profile_t *prof, long n_record) {
+  bool sample_f = n_record % SELF_PROFILE_PERIOD == 0;
+  if (prof->phase == PHASE_NONE && !sample_f)
+    return;
+  phase_switch(prof, sample_f ? PHASE_PARSE : PHASE_NONE);
+  if (sample_f)
+    prof->n_sampled++;
+  if (n_record == 0) {  // the trace loop starts
+    memcpy(prof->loop_start, prof->last, sizeof(prof->last));
+    prof->loop_start_ns = prof->last_ns;
+    prof->n_loop_switch = 0;
+  }
+}
+
+/* Cost of a phase without the switch overhead, per sampled record (or
+ * per access for stats). */
+double phase_cost(self_profile_t *prof, int phase, unsigned long total, double overhead, double per) {
+  double cost = total - prof->n_interval[phase] * overhead;
+  return (cost > 0 ? cost : 0) * per;
+}
+
+/* Splits the per access cost of the trace loop, without its switches,
+ * between the per record phases in their sampled proportions. */
+void scale_to_loop(self_profile_t *prof, double *cost, unsigned long loop, double overhead,
+        long n_access) {
+  double sampled = cost[PHASE_PARSE] + cost[PHASE_ACCESS] + cost[PHASE_SNOOP];
+  if (sampled <= 0 || n_access == 0)
+    return;
+  double per_access = (loop - prof->n_loop_switch * overhead) / n_access;
+  if (per_access < 0)
+    per_access = 0;
+  for (int p = PHASE_PARSE; p <= PHASE_SNOOP; p++)
+    cost[p] *= per_access / sampled;
+}
+
+void print_self_profile(self_profile_t *prof, long n_access) {
+  printf("Simulator self-profile (%s, 1 in %d records, %.0f ns/switch subtracted):\n",
+         prof->group_fd < 0 ? "clock_gettime only" : prof->rdpmc_f ? "rdpmc" : "perf_event_open",
+         SELF_PROFILE_PERIOD, prof->overhead_ns);
+  printf("phase \t      ms\t  ns/acc");
+  if (prof->group_fd >= 0)
+    printf("\tcycles/acc\tinsns/acc\tllc_miss/acc\tIPC");
+  printf("\n");
+  // [phase][counter], the last column being ns
+  double cost[N_HOST_COUNTER + 1][N_PHASE];
+  for (int p = 0; p < N_PHASE; p++) {
+    // per record phases are averaged over the sampled records, stats
+    // runs once
+    double per = (p == PHASE_STATS) ? (n_access ? 1.0 / n_access : 0.0)
+            : (prof->n_sampled ? 1.0 / prof->n_sampled : 0.0);
+    for (int c = 0; c < N_HOST_COUNTER; c++)
+      cost[c][p] = phase_cost(prof, p, prof->total[p][c], prof->overhead[c], per);
+    cost[N_HOST_COUNTER][p] = phase_cost(prof, p, prof->total_ns[p], prof->overhead_ns, per);
+  }
+  for (int c = 0; c < N_HOST_COUNTER; c++)
+    scale_to_loop(prof, cost[c], prof->loop[c], prof->overhead[c], n_access);
+  scale_to_loop(prof, cost[N_HOST_COUNTER], prof->loop_ns, prof->overhead_ns, n_access);
+
+  for (int p = 0; p < N_PHASE; p++) {
+    double ns = cost[N_HOST_COUNTER][p];
+    double t[N_HOST_COUNTER];
+    for (int c = 0; c < N_HOST_COUNTER; c++)
+      t[c] = cost[c][p];
+    printf("%-6s\t%8.2f\t%8.2f", phase_names[p], ns * n_access / 1e6, ns);
+    if (prof->group_fd >= 0) {
+      printf("\t%10.2f", t[HC_CYCLES]);
+      if (prof->counter_f[HC_INSTRUCTIONS])
+        printf("\t%9.2f", t[HC_INSTRUCTIONS]);
+      else
+        printf("\t%9s", "-");
+      if (prof->counter_f[HC_LLC_MISSES])
+        printf("\t%12.4f", t[HC_LLC_MISSES]);
+      else
+        printf("\t%12s", "-");
+      if (prof->counter_f[HC_INSTRUCTIONS] && t[HC_CYCLES] > 0)
+        printf("\t%.2f", t[HC_INSTRUCTIONS] / t[HC_CYCLES]);
+    }
+    printf("\n");
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef __SELF_PROFILE_H
+#define __SELF_PROFILE_H
+
+#include <stdbool.h>
+
+// phases of process_trace the simulator's own run time is charged to
+enum phase_t { PHASE_PARSE, PHASE_ACCESS, PHASE_SNOOP, PHASE_STATS, N_PHASE, PHASE_NONE = N_PHASE };
+
+// host counters read around each phase
+enum host_counter_t { HC_CYCLES, HC_INSTRUCTIONS, HC_LLC_MISSES, N_HOST_COUNTER };
+
+// one in this many trace records is timed phase by phase
+#define SELF_PROFILE_PERIOD 64
+
+/* Self-instrumentation of the simulator's hot path.
+ *
+ * Host cycles, instructions and LLC misses come from one perf_event_open
+ * group (Linux only). Where the kernel allows it, the counters are read in
+ * user space with rdpmc through each event's mmap page, else with read().
+ * Wall-clock time from clock_gettime is always recorded, so the report
+ * still works where perf events are unavailable (non-Linux, or
+ * perf_event_paranoid).
+ *
+ * Only every SELF_PROFILE_PERIOD-th record is split into phases, with the
+ * cost of a phase switch (calibrated at startup) subtracted from every
+ * interval. The samples only give the split between the phases: their
+ * totals come from the whole trace loop, less the switches made in it, so
+ * the numbers are those of the simulator, not of the instrumentation.
+ */
+typedef struct {
+  int fd[N_HOST_COUNTER];           // -1 where a counter didn't open
+  int group_fd;                     // -1 if perf events are unavailable
+  bool counter_f[N_HOST_COUNTER];   // which counters opened
+  void *mmap_page[N_HOST_COUNTER];  // struct perf_event_mmap_page, for rdpmc
+  bool rdpmc_f;
+
+  enum phase_t phase;
+  unsigned long last[N_HOST_COUNTER];
+  unsigned long last_ns;
+
+  unsigned long total[N_PHASE][N_HOST_COUNTER];
+  unsigned long total_ns[N_PHASE];
+  long n_interval[N_PHASE];
+  long n_sampled;
+
+  // the whole trace loop, which the sampled phases are scaled to
+  unsigned long loop_start[N_HOST_COUNTER];
+  unsigned long loop_start_ns;
+  unsigned long loop[N_HOST_COUNTER];
+  unsigned long loop_ns;
+  long n_loop_switch;
+
+  // cost of one phase_switch
+  double overhead[N_HOST_COUNTER];
+  double overhead_ns;
+} self_profile_t;
+
+self_profile_t *make_self_profile();
+void phase_switch(self_profile_t *prof, enum phase_t phase);
+void sample_phase(self_profile_t *prof, enum phase_t phase);
+void next_sample(self_profile_t *prof, long n_record);
+void print_self_profile(self_profile_t *prof, long n_access);
+
+#endif  // SELF_PROFILE
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_api.h"
+
+/* Reads every record of the trace into memory. Takes the same trace name,
+ * interleave policy and skew as -t/-m on the command line. Returns NULL if
+ * the trace can't be opened. */
+loaded_trace_t *load_trace(const char *trace, int n_core, int interleave, unsigned long skew) {
+  trace_reader_t *reader = open_trace(trace, n_core, interleave, skew);
+  if (reader == NULL)
+    return NULL;
+  loaded_trace_t *loaded = malloc(sizeof(loaded_trace_t));
+  long cap = 1024;
+  loaded->records = malloc(cap * sizeof(trace_record_t));
+  loaded->n_record = 0;
+  loaded->n_core = 1;
+
+  trace_record_t record;
+  while (next_record(reader, &record)) {
+    if (loaded->n_record == cap) {
+      cap *= 2;
+      loaded->records = realloc(loaded->records, cap * sizeof(trace_record_t));
+    }
+    loaded->records[loaded->n_record++] = record;
+    if (record.core + 1 > loaded->n_core)
+      loaded->n_core = record.core + 1;
+  }
+  close_trace(reader);
+  return loaded;
+}
+
+void free_loaded_trace(loaded_trace_t *trace) {
+  free(trace->records);
+  free(trace);
+}
+
+/* Simulates one configuration and copies each core's stats (with rates
+ * calculated) into stats[0..n_core-1]. Returns -1 for a configuration the
+ * command line would reject, or one with fewer cores than the trace uses. */
+int run_config(loaded_trace_t *trace, sim_config_t *config, cache_stats_t *stats) {
+  if (config->log_capacity < 0 || config->log_capacity > MAX_LOG_CAPACITY ||
+          config->log_block_size < 0 || config->log_block_size > 25 ||
+          config->assoc <= 0 || config->protocol < NONE || config->protocol > MSI ||
+          config->n_core < trace->n_core)
+    return -1;
+  long capacity = 1L << config->log_capacity;
+  int block_size = 1 << config->log_block_size;
+  if (capacity / block_size / config->assoc == 0)
+    return -1;
+
+  simulator_t *sim = make_simulator();
+  sim->n_core = config->n_core;
+  sim->protocol = config->protocol;
+  sim->lru_on_invalidate_f = config->lru_on_invalidate_f;
+  sim->cache = malloc(sim->n_core * sizeof(cache_t*));
+  for (int i = 0; i < sim->n_core; i++)
+    sim->cache[i] = make_cache(capacity, block_size, config->assoc, sim->protocol, sim->lru_on_invalidate_f);
+
+  long n_record = trace->n_record;
+  if (config->insn_limit > 0 && config->insn_limit < n_record)
+    n_record = config->insn_limit;
+  for (long r = 0; r < n_record; r++) {
+    trace_record_t *record = &trace->records[r];
+    simulate_access(sim, record->core, record->cmd, record->addr);
+  }
+
+  for (int i = 0; i < sim->n_core; i++) {
+    calculate_stat_rates(sim->cache[i]->stats, block_size);
+    stats[i] = *sim->cache[i]->stats;
+    free_cache(sim->cache[i]);
+  }
+  free(sim->cache);
+  free(sim);
+  return 0;
+}
+
+/* Runs n_config configurations back to back. Config i's stats go to
+ * stats[i * stride ...], so stride must be at least the largest n_core.
+ * Returns the number of configurations that failed to run. */
+int run_batch(loaded_trace_t *trace, sim_config_t *configs, int n_config, cache_stats_t *stats, int stride) {
+  int n_failed = 0;
+  for (int i = 0; i < n_config; i++) {
+    if (configs[i].n_core > stride || run_config(trace, &configs[i], &stats[i * stride]) != 0)
+      n_failed++;
+  }
+  return n_failed;
+}
@@ -0,0 +1,34 @@
+#ifndef __SIM_API_H
+#define __SIM_API_H
+
+#include "simulator.h"
+
+/* Library interface for embedding the simulator (see cachesim.py).
+ *
+ * A trace is parsed once into memory and can then be simulated under any
+ * number of configurations without printing anything. All functions only
+ * touch the memory passed to them, so callers may release the Python GIL.
+ */
+
+typedef struct {
+  int log_capacity;
+  int log_block_size;
+  int assoc;
+  int protocol;             // enum protocol_t
+  int n_core;
+  int lru_on_invalidate_f;
+  long insn_limit;          // <= 0 to simulate the whole trace
+} sim_config_t;
+
+typedef struct {
+  long n_record;
+  trace_record_t *records;
+  int n_core;  // cores the trace needs
+} loaded_trace_t;
+
+loaded_trace_t *load_trace(const char *trace, int n_core, int interleave, unsigned long skew);
+void free_loaded_trace(loaded_trace_t *trace);
+int run_config(loaded_trace_t *trace, sim_config_t *config, cache_stats_t *stats);
+int run_batch(loaded_trace_t *trace, sim_config_t *configs, int n_config, cache_stats_t *stats, int stride);
+
+#endif  // SIM_API
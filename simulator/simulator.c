@@ -5,11 +5,14 @@
 
 #include "simulator.h"
 #include "print_helpers.h"
+#include "result_store.h"
 
 simulator_t *make_simulator() {
     simulator_t *sim = malloc(sizeof(simulator_t));
 
     sim->trace = "route.1t.short.txt";
+    sim->interleave = INTERLEAVE_FILE;
+    sim->skew = 0;
     sim->verbose_f = false;
 
     sim->limit_insn_f = false;
@@ -20,9 +23,138 @@ simulator_t *make_simulator() {
 
     sim->lru_on_invalidate_f = false;
 
+    sim->socket_map = NULL;
+    sim->home_interleave_bit = 12;
+    sim->topology = NULL;
+
+    sim->profile = NULL;
+    sim->profile_window = 10000;
+    sim->profiler = NULL;
+
+    sim->self_profile = NULL;
+
+    sim->n_victim = 0;
+    sim->snoop_filter_f = false;
+
+    sim->tlb_entries = 0;
+    sim->tlb_assoc = 0;
+    sim->tlb_page_bit = 12;
+
+    sim->n_mshr = 0;
+    sim->miss_latency = 100;
+
+    sim->result_store_dir = NULL;
+    sim->filter_trace = NULL;
+    sim->filter_out = NULL;
+    sim->n_filtered = 0;
+
     return sim;
 }
 
+/*
+ * Opens trace/<name> for the filtered miss/writeback stream.
+ */
+FILE *open_filter_trace(simulator_t *sim) {
+    char *path = malloc(strlen(sim->filter_trace) + 7);
+    strcpy(path, "trace/");
+    strcat(path, sim->filter_trace);
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        printf("Unable to write filtered trace \'%s\'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    free(path);
+    return out;
+}
+
+/*
+ * Simulates one (physical) access by core: the cache access, the snoops
+ * its miss puts on the bus, and every optional model hooked onto them.
+ * Returns whether it hit.
+ */
+bool access_memory(simulator_t *sim, int core, char cmd, unsigned long address) {
+    int i;
+    enum action_t action = (cmd == 'r') ? LOAD : STORE;
+
+    if (sim->self_profile != NULL) sample_phase(sim->self_profile, PHASE_ACCESS);
+
+    // access the cache
+    long n_upgrade_miss = sim->cache[core]->stats->n_upgrade_miss;
+    bool hit_f = access_cache(sim->cache[core], address, action);
+    unsigned long block_addr = get_cache_block_addr(sim->cache[core], address);
+
+    if (sim->profiler != NULL)
+        profile_access(sim->profiler, core, block_addr);
+
+    if (sim->cache[core]->mshr != NULL)
+        mshr_access(sim->cache[core]->mshr, block_addr, hit_f);
+
+    // prints the insn
+    if (sim->verbose_f) print_insn_info(sim, core, cmd, address, hit_f);
+
+    // only misses and writebacks make it into the filtered trace
+    if (sim->filter_out != NULL) {
+        if (!hit_f) {
+            fprintf(sim->filter_out, "%d %c %lx\n", core, cmd, address);
+            sim->n_filtered++;
+        }
+        if (sim->cache[core]->writeback_f) {
+            fprintf(sim->filter_out, "%d w %lx\n", core, sim->cache[core]->writeback_addr);
+            sim->n_filtered++;
+        }
+    }
+
+    // misses go on the bus
+    // (LOAD --> LD_MISS, STORE --> ST_MISS)
+    if (!hit_f) { 
+        int supplier = -1;
+        if (sim->self_profile != NULL) sample_phase(sim->self_profile, PHASE_SNOOP);
+        for (i = 0; i < sim->n_core; i++){ // 1 core? does nothing
+            if (i != core) {
+                access_cache(sim->cache[i], address,
+                        (action == LOAD) ? LD_MISS : ST_MISS);
+                if (sim->cache[i]->mshr != NULL)
+                    mshr_snoop(sim->cache[i]->mshr, block_addr, sim->cache[i]->invalidate_f);
+                // a snooped modified line is flushed by its owner
+                if (sim->cache[i]->writeback_f) {
+                    supplier = i;
+                    if (sim->filter_out != NULL) {
+                        fprintf(sim->filter_out, "%d w %lx\n", i, sim->cache[i]->writeback_addr);
+                        sim->n_filtered++;
+                    }
+                    if (sim->topology != NULL)
+                        topology_writeback(sim->topology, i, sim->cache[i]->writeback_addr);
+                }
+            }  
+        }
+        // upgrade misses already hold the data, they only need the request
+        if (sim->topology != NULL)
+            topology_miss(sim->topology, core, block_addr, sim->protocol != NONE,
+                    sim->cache[core]->stats->n_upgrade_miss == n_upgrade_miss, supplier);
+    }
+    if (sim->topology != NULL && sim->cache[core]->writeback_f)
+        topology_writeback(sim->topology, core, sim->cache[core]->writeback_addr);
+    return hit_f;
+}
+
+/*
+ * Simulates one trace record. With a TLB, a miss first walks the page
+ * table, and every page table load is a real access of the data cache.
+ */
+void simulate_access(simulator_t *sim, int core, char cmd, unsigned long address) {
+    tlb_t *tlb = sim->cache[core]->tlb;
+    if (tlb != NULL && !tlb_lookup(tlb, address)) {
+        unsigned long pte_addrs[PT_LEVELS];
+        int n = walk_addresses(tlb, address, pte_addrs);
+        for (int i = 0; i < n; i++) {
+            tlb->n_walk_accesses++;
+            if (!access_memory(sim, core, 'r', pte_addrs[i]))
+                tlb->n_walk_misses++;
+        }
+    }
+    access_memory(sim, core, cmd, address);
+}
+
 /*
  * Goes through the trace line by line (i.e., instruction by
  * instruction) and simulates the program being executed on a
@@ -30,69 +162,79 @@ simulator_t *make_simulator() {
  */
 void process_trace(simulator_t *sim) {
     int i;
-    char *line = NULL;
+    trace_record_t record;
     // Program Stats
     long total_insn = 0;
 
     printf("Processing trace...\n");
     printf("%d %d\n", sim->n_core, sim->protocol);
 
-    char *path = malloc(strlen(sim->trace) + 7);
-    strncpy(path, "trace/", 7);
-    strcat(path, sim->trace);
-    FILE *trace = fopen(path, "r");
-    if (trace == NULL) {
-        printf("File \'%s\' not found\n", sim->trace);
+    trace_reader_t *trace = open_trace(sim->trace, sim->n_core, sim->interleave, sim->skew);
+    if (trace == NULL)
         exit(EXIT_FAILURE);
+
+    // verbose, filter and profile runs need the per insn output, so they
+    // always simulate
+    bool store_f = sim->result_store_dir != NULL && !sim->verbose_f &&
+            sim->filter_trace == NULL && sim->profile == NULL;
+    if (store_f && result_store_lookup(sim, hash_trace_reader(trace))) {
+        close_trace(trace);
+        return;
     }
-    size_t len = 0;
-    size_t read;
+    if (sim->filter_trace != NULL)
+        sim->filter_out = open_filter_trace(sim);
 
-    while ((read = getline(&line, &len, trace)) != -1) {
+    if (sim->self_profile != NULL) next_sample(sim->self_profile, 0);
+    while (next_record(trace, &record)) {
         if (sim->limit_insn_f && total_insn == sim->insn_limit) {
             printf("Reached insn limit of %d. Ending Simulation...\n",
                     sim->insn_limit);
             break;
         }
 
-        int core = line[0]-'0'; // turn the '0' into a 0
+        int core = record.core;
         if (core > (sim->n_core - 1)) {
             printf("ERROR: this trace requires atleast %d cores!\n", core + 1);
             exit(EXIT_FAILURE);
         }
 
-        enum action_t action = (line[2] == 'r') ? LOAD : STORE;
-        unsigned long address = strtol(&line[4], NULL, 16);
-
         total_insn++;
-
-        // access the cache
-        bool hit_f = access_cache(sim->cache[core], address, action);
-
-        // prints the insn
-        if (sim->verbose_f) print_insn_info(sim, core, line[2], address, hit_f);
-
-        // misses go on the bus
-        // (LOAD --> LD_MISS, STORE --> ST_MISS)
-        if (!hit_f) { 
-            for (i = 0; i < sim->n_core; i++){ // 1 core? does nothing
-                if (i != core) {
-                    access_cache(sim->cache[i], address,
-                            (action == LOAD) ? LD_MISS : ST_MISS);
-                }  
-            }
-        }
+        simulate_access(sim, core, record.cmd, record.addr);
+        if (sim->self_profile != NULL) next_sample(sim->self_profile, total_insn);
     }
 
-    fclose(trace);
-    if (line) free(line);
+    // everything from here on is charged to stats
+    if (sim->self_profile != NULL) phase_switch(sim->self_profile, PHASE_STATS);
+    close_trace(trace);
 
     printf("Processed %ld lines.\n", total_insn);
 
+    if (sim->filter_out != NULL) {
+        fclose(sim->filter_out);
+        printf("Filtered trace \t%s\n", sim->filter_trace);
+        printf("Filtered %ld of %ld lines (%.2fx reduction)\n", sim->n_filtered,
+                total_insn, sim->n_filtered ? total_insn / (double)sim->n_filtered : 0.0);
+    }
+
+    if (sim->profiler != NULL) {
+        if (write_reuse_profile(sim->profiler, sim->profile))
+            printf("Reuse profile \t%s.reuse.txt, %s.wss.txt\n", sim->profile, sim->profile);
+        else
+            printf("Unable to write reuse profile \'%s\'\n", sim->profile);
+    }
+
     // compute cache statistics
     for (i = 0; i < sim->n_core; i++){
         calculate_stat_rates(sim->cache[i]->stats, sim->cache[i]->block_size);  
-        printf("    *** Results for Core %d ***\n", i);
-        print_stats(sim->cache[i]->stats, i);
+        fprint_core_results(stdout, sim, i);
     }
+    if (sim->topology != NULL)
+        fprint_topology_stats(stdout, sim->topology);
+
+    if (sim->self_profile != NULL) {
+        phase_switch(sim->self_profile, PHASE_NONE);
+        print_self_profile(sim->self_profile, total_insn);
+    }
+
+    if (store_f) result_store_save(sim, total_insn);
 }
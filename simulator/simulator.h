@@ -2,12 +2,26 @@
 #define __SIMULATOR_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "cache.h"
 #include "cache_stats.h"
+#include "trace_reader.h"
+#include "topology.h"
+#include "reuse_profile.h"
+#include "self_profile.h"
+
+// bump whenever a change alters simulation results, so stored results
+// from older builds are not replayed
+#define SIM_VERSION "1.1"
 
 typedef struct {
   char* trace;
 
+  // how per-core trace files are merged, INTERLEAVE_FILE for a single
+  // pre-interleaved trace
+  enum interleave_t interleave;
+  unsigned long skew;
+
   // print per access information, by default off
   bool verbose_f;
 
@@ -22,10 +36,46 @@ typedef struct {
   cache_t** cache;
 
   enum protocol_t protocol;
+
+  // core to socket layout, NULL for a single flat bus
+  char* socket_map;
+  int home_interleave_bit;
+  topology_t *topology;
+
+  // reuse distance / working set profiling, written to <profile>.*.txt
+  char* profile;
+  long profile_window;
+  reuse_profiler_t *profiler;
+
+  // host time/counters per phase of process_trace, NULL when off
+  self_profile_t *self_profile;
+
+  // victim cache entries per core (0 for none) and per-core snoop filters
+  int n_victim;
+  bool snoop_filter_f;
+
+  // per-core TLB (0 entries for none) and the page size, as log2
+  int tlb_entries;
+  int tlb_assoc;
+  int tlb_page_bit;
+
+  // MSHRs per core and miss latency in cycles, 0 MSHRs for blocking caches
+  int n_mshr;
+  int miss_latency;
+
+  // directory of memoized results, NULL to always simulate
+  char* result_store_dir;
+
+  // if set, write the miss and writeback stream to trace/<filter_trace>
+  char* filter_trace;
+  FILE* filter_out;
+  long n_filtered;
   
 } simulator_t;
 
 simulator_t* make_simulator();
+bool access_memory(simulator_t *sim, int core, char cmd, unsigned long address);
+void simulate_access(simulator_t *sim, int core, char cmd, unsigned long address);
 void process_trace(simulator_t *sim);
 
 #endif  // SIMULATOR
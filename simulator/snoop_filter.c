@@ -0,0 +1,48 @@
+#include <stdlib.h>
+
+#include "snoop_filter.h"
+
+/* Sized at 8 counters per tracked block, which keeps the false positive
+ * rate of the two probes around 2%. */
+snoop_filter_t *make_snoop_filter(long n_block) {
+  snoop_filter_t *filter = malloc(sizeof(snoop_filter_t));
+  unsigned long size = 64;
+  while (size < 8 * (unsigned long)n_block)
+    size <<= 1;
+  filter->counts = calloc(size, sizeof(unsigned int));
+  filter->mask = size - 1;
+  filter->n_snoops = 0;
+  filter->n_filtered = 0;
+  return filter;
+}
+
+void free_snoop_filter(snoop_filter_t *filter) {
+  free(filter->counts);
+  free(filter);
+}
+
+unsigned long mix_block(unsigned long block_addr) {
+  block_addr ^= block_addr >> 33;
+  block_addr *= 0xff51afd7ed558ccdUL;
+  block_addr ^= block_addr >> 33;
+  block_addr *= 0xc4ceb9fe1a85ec53UL;
+  block_addr ^= block_addr >> 33;
+  return block_addr;
+}
+
+void snoop_filter_insert(snoop_filter_t *filter, unsigned long block_addr) {
+  unsigned long h = mix_block(block_addr);
+  filter->counts[h & filter->mask]++;
+  filter->counts[(h >> 32) & filter->mask]++;
+}
+
+void snoop_filter_remove(snoop_filter_t *filter, unsigned long block_addr) {
+  unsigned long h = mix_block(block_addr);
+  filter->counts[h & filter->mask]--;
+  filter->counts[(h >> 32) & filter->mask]--;
+}
+
+bool snoop_filter_may_hold(snoop_filter_t *filter, unsigned long block_addr) {
+  unsigned long h = mix_block(block_addr);
+  return filter->counts[h & filter->mask] && filter->counts[(h >> 32) & filter->mask];
+}
@@ -0,0 +1,25 @@
+#ifndef __SNOOP_FILTER_H
+#define __SNOOP_FILTER_H
+
+#include <stdbool.h>
+
+/* Counting Bloom filter over the blocks a cache (and its victim cache)
+ * holds a tag for. A remote miss whose block the filter rules out can
+ * skip the tag lookup entirely. The filter is conservative: it may let
+ * through snoops for blocks the cache doesn't hold, never the reverse.
+ */
+typedef struct {
+  unsigned int *counts;
+  unsigned long mask;  // counts has mask + 1 entries
+
+  long n_snoops;
+  long n_filtered;
+} snoop_filter_t;
+
+snoop_filter_t *make_snoop_filter(long n_block);
+void free_snoop_filter(snoop_filter_t *filter);
+void snoop_filter_insert(snoop_filter_t *filter, unsigned long block_addr);
+void snoop_filter_remove(snoop_filter_t *filter, unsigned long block_addr);
+bool snoop_filter_may_hold(snoop_filter_t *filter, unsigned long block_addr);
+
+#endif  // SNOOP_FILTER
@@ -0,0 +1,65 @@
+#include <stdlib.h>
+
+#include "tlb.h"
+
+tlb_t *make_tlb(int n_entry, int assoc, int page_bit) {
+  tlb_t *tlb = malloc(sizeof(tlb_t));
+  tlb->n_entry = n_entry;
+  tlb->assoc = assoc;
+  tlb->n_set = n_entry / assoc;
+  tlb->page_bit = page_bit;
+  tlb->entries = calloc(n_entry, sizeof(tlb_entry_t));
+  tlb->clock = 0;
+
+  tlb->n_lookups = 0;
+  tlb->n_hits = 0;
+  tlb->n_walk_accesses = 0;
+  tlb->n_walk_misses = 0;
+  return tlb;
+}
+
+void free_tlb(tlb_t *tlb) {
+  free(tlb->entries);
+  free(tlb);
+}
+
+/* Looks up the page of vaddr, filling it over the set's LRU entry on a
+ * miss. Returns true on a hit. */
+bool tlb_lookup(tlb_t *tlb, unsigned long vaddr) {
+  unsigned long vpn = vaddr >> tlb->page_bit;
+  tlb_entry_t *set = &tlb->entries[(vpn % tlb->n_set) * tlb->assoc];
+  tlb_entry_t *victim = &set[0];
+  tlb->n_lookups++;
+  tlb->clock++;
+
+  for (int way = 0; way < tlb->assoc; way++) {
+    if (set[way].valid && set[way].vpn == vpn) {
+      set[way].lru_stamp = tlb->clock;
+      tlb->n_hits++;
+      return true;
+    }
+    if (!set[way].valid || (victim->valid && set[way].lru_stamp < victim->lru_stamp))
+      victim = &set[way];
+  }
+  victim->vpn = vpn;
+  victim->valid = true;
+  victim->lru_stamp = tlb->clock;
+  return false;
+}
+
+/* Fills pte_addrs with the page table entries a walk for vaddr loads,
+ * root first, and returns how many there are. A level's entry is indexed
+ * by every virtual address bit above that level, so each distinct table
+ * gets its own entries. */
+int walk_addresses(tlb_t *tlb, unsigned long vaddr, unsigned long *pte_addrs) {
+  int n = 0;
+  for (int level = 0; level < PT_LEVELS; level++) {
+    // bits translated below this level, 39 for the root down to 12
+    int shift = 12 + PT_INDEX_BITS * (PT_LEVELS - 1 - level);
+    if (shift < tlb->page_bit)
+      break;
+    pte_addrs[n++] = PAGE_TABLE_BASE + ((unsigned long)level << PT_LEVEL_SHIFT) +
+            (vaddr >> shift) * PTE_SIZE;
+  }
+  return n;
+}
@@ -0,0 +1,43 @@
+#ifndef __TLB_H
+#define __TLB_H
+
+#include <stdbool.h>
+
+// x86-64 style 4-level radix page table, 9 index bits per level
+#define PT_LEVELS 4
+#define PT_INDEX_BITS 9
+#define PTE_SIZE 8
+// page table entries are placed in their own (physical) region, one per
+// level, so walks never alias trace data
+#define PAGE_TABLE_BASE 0xc000000000000000UL
+#define PT_LEVEL_SHIFT 58
+
+typedef struct {
+  unsigned long vpn;
+  bool valid;
+  long lru_stamp;
+} tlb_entry_t;
+
+/* Set associative, LRU TLB for one core and one page size (4KB, 2MB or
+ * 1GB). A miss walks the levels of the page table above the page size
+ * (4, 3 or 2 loads), which the simulator sends through the data cache. */
+typedef struct {
+  int n_entry;
+  int assoc;
+  int n_set;
+  int page_bit;    // log2 of the page size
+  tlb_entry_t *entries;  // n_set * assoc
+  long clock;
+
+  long n_lookups;
+  long n_hits;
+  long n_walk_accesses;  // page table loads sent to the cache
+  long n_walk_misses;    // ... that missed in it
+} tlb_t;
+
+tlb_t *make_tlb(int n_entry, int assoc, int page_bit);
+void free_tlb(tlb_t *tlb);
+bool tlb_lookup(tlb_t *tlb, unsigned long vaddr);
+int walk_addresses(tlb_t *tlb, unsigned long vaddr, unsigned long *pte_addrs);
+
+#endif  // TLB
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topology.h"
+
+/* Parses a comma separated core to socket map, e.g. "0,0,1,1" puts cores
+ * 0-1 on socket 0 and cores 2-3 on socket 1. Returns NULL if the map
+ * names anything but one socket for each of the n_core cores. */
+topology_t *make_topology(const char *socket_map, int n_core, int home_interleave_bit, int block_size) {
+  topology_t *topo = malloc(sizeof(topology_t));
+  topo->socket_of = malloc(n_core * sizeof(int));
+  topo->n_socket = 0;
+  // a granule smaller than a block would leave the low index bits zero
+  // and home every block on the same socket, so interleave whole blocks
+  topo->home_interleave_bit = home_interleave_bit;
+  while ((1L << topo->home_interleave_bit) < block_size)
+    topo->home_interleave_bit++;
+  topo->block_size = block_size;
+
+  const char *p = socket_map;
+  for (int i = 0; i < n_core; i++) {
+    char *end;
+    topo->socket_of[i] = strtol(p, &end, 10);
+    if (end == p || topo->socket_of[i] < 0 || *end != ((i < n_core - 1) ? ',' : '\0')) {
+      free(topo->socket_of);
+      free(topo);
+      return NULL;
+    }
+    if (topo->socket_of[i] + 1 > topo->n_socket)
+      topo->n_socket = topo->socket_of[i] + 1;
+    p = end + 1;
+  }
+
+  topo->socket_bus = calloc(topo->n_socket, sizeof(link_stats_t));
+  topo->link.n_msgs = 0;
+  topo->link.B_traffic = 0;
+  return topo;
+}
+
+int home_socket(topology_t *topo, unsigned long block_addr) {
+  return (block_addr >> topo->home_interleave_bit) % topo->n_socket;
+}
+
+/* Accounts one message of the given size between two sockets. Traffic
+ * within a socket stays on its bus; anything else crosses the link. */
+void send_msg(topology_t *topo, int from, int to, int bytes) {
+  link_stats_t *link = (from == to) ? &topo->socket_bus[from] : &topo->link;
+  link->n_msgs++;
+  link->B_traffic += bytes;
+}
+
+/* Accounts the traffic of a miss by core.
+ *  broadcast_f -- the request is snooped by every socket (VI/MSI), rather
+ *                 than sent to the home socket only
+ *  data_f      -- the miss needs the block (false for upgrade misses)
+ *  supplier    -- core that flushed the block from its cache, -1 if the
+ *                 home memory supplies it
+ */
+void topology_miss(topology_t *topo, int core, unsigned long block_addr, bool broadcast_f, bool data_f, int supplier) {
+  int socket = topo->socket_of[core];
+  int home = home_socket(topo, block_addr);
+
+  if (broadcast_f) {
+    for (int s = 0; s < topo->n_socket; s++)
+      send_msg(topo, socket, s, MSG_HEADER_BYTES);
+  } else {
+    send_msg(topo, socket, home, MSG_HEADER_BYTES);
+  }
+
+  if (data_f) {
+    int from = (supplier >= 0) ? topo->socket_of[supplier] : home;
+    send_msg(topo, from, socket, MSG_HEADER_BYTES + topo->block_size);
+  }
+}
+
+/* Accounts a dirty block written back from core's cache to its home. */
+void topology_writeback(topology_t *topo, int core, unsigned long block_addr) {
+  send_msg(topo, topo->socket_of[core], home_socket(topo, block_addr),
+          MSG_HEADER_BYTES + topo->block_size);
+}
+
+void fprint_topology_stats(FILE *out, topology_t *topo) {
+  long intra_msgs = 0, intra_bytes = 0;
+  fprintf(out, "Interconnect (%d sockets, home interleave 2^%d B):\n",
+          topo->n_socket, topo->home_interleave_bit);
+  for (int s = 0; s < topo->n_socket; s++) {
+    fprintf(out, "s%d.n_bus_msgs \t\t%ld\n", s, topo->socket_bus[s].n_msgs);
+    fprintf(out, "s%d.B_bus_traffic \t%ld\n", s, topo->socket_bus[s].B_traffic);
+    intra_msgs += topo->socket_bus[s].n_msgs;
+    intra_bytes += topo->socket_bus[s].B_traffic;
+  }
+  fprintf(out, "n_intra_socket_msgs \t%ld\n", intra_msgs);
+  fprintf(out, "B_intra_socket_traffic \t%ld\n", intra_bytes);
+  fprintf(out, "n_inter_socket_msgs \t%ld\n", topo->link.n_msgs);
+  fprintf(out, "B_inter_socket_traffic \t%ld\n", topo->link.B_traffic);
+}
@@ -0,0 +1,39 @@
+#ifndef __TOPOLOGY_H
+#define __TOPOLOGY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// size of a request/ack with no data attached, in Bytes
+#define MSG_HEADER_BYTES 8
+
+typedef struct {
+  long n_msgs;
+  long B_traffic;
+} link_stats_t;
+
+/* Multi-socket layout of the simulated cores.
+ *
+ * Every socket has its own snooping bus, and the sockets are connected by
+ * one inter-socket link. Memory is spread over the sockets by interleaving
+ * block addresses on 2^home_interleave_bit byte granules (at least one
+ * block), so each block has a home socket that serves its fills and absorbs
+ * its writebacks.
+ */
+typedef struct {
+  int n_socket;
+  int *socket_of;  // per core
+  int home_interleave_bit;
+  int block_size;
+
+  link_stats_t *socket_bus;  // one per socket
+  link_stats_t link;         // inter-socket
+} topology_t;
+
+topology_t *make_topology(const char *socket_map, int n_core, int home_interleave_bit, int block_size);
+int home_socket(topology_t *topo, unsigned long block_addr);
+void topology_miss(topology_t *topo, int core, unsigned long block_addr, bool broadcast_f, bool data_f, int supplier);
+void topology_writeback(topology_t *topo, int core, unsigned long block_addr);
+void fprint_topology_stats(FILE *out, topology_t *topo);
+
+#endif  // TOPOLOGY
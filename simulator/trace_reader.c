@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_reader.h"
+#include "fnv_hash.h"
+
+/* Builds "trace/<name>". In per-core mode (core >= 0) the one %d in the
+ * name is replaced by the core number (e.g. -t app.core%d.txt); the name
+ * is never used as a format string. */
+char *trace_path(const char *trace, int core) {
+  size_t len = strlen(trace) + 32;
+  char *path = malloc(len);
+  const char *core_pos = (core >= 0) ? strstr(trace, "%d") : NULL;
+  if (core_pos == NULL)
+    snprintf(path, len, "trace/%s", trace);
+  else
+    snprintf(path, len, "trace/%.*s%d%s", (int)(core_pos - trace), trace, core, core_pos + 2);
+  return path;
+}
+
+/* Per-core trace names need exactly one %d and no other % sequence. */
+bool valid_per_core_name(const char *trace) {
+  const char *percent = strchr(trace, '%');
+  return percent != NULL && percent[1] == 'd' && strchr(percent + 2, '%') == NULL;
+}
+
+FILE *open_trace_file(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    printf("Unable to read trace file \'%s\'\n", path);
+  return f;
+}
+
+/* Records are ordered by merge key, ties going to the lower core so
+ * round robin comes out as 0, 1, 2, ... */
+bool record_before(trace_record_t *a, trace_record_t *b) {
+  if (a->time != b->time)
+    return a->time < b->time;
+  return a->core < b->core;
+}
+
+void heap_push(trace_reader_t *reader, trace_record_t *record) {
+  int i = reader->heap_size++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!record_before(record, &reader->heap[parent]))
+      break;
+    reader->heap[i] = reader->heap[parent];
+    i = parent;
+  }
+  reader->heap[i] = *record;
+}
+
+/* Restores the heap order after the root record was replaced. */
+void heap_sift_down(trace_reader_t *reader) {
+  trace_record_t root = reader->heap[0];
+  int i = 0;
+  while (true) {
+    int child = 2 * i + 1;
+    if (child >= reader->heap_size)
+      break;
+    if (child + 1 < reader->heap_size && record_before(&reader->heap[child + 1], &reader->heap[child]))
+      child++;
+    if (!record_before(&reader->heap[child], &root))
+      break;
+    reader->heap[i] = reader->heap[child];
+    i = child;
+  }
+  reader->heap[i] = root;
+}
+
+/* Reads the next "<timestamp> <r/w> <addr>" record of a per-core file
+ * and assigns its merge key. Returns false at the end of the file. */
+bool read_core_record(trace_reader_t *reader, int core, trace_record_t *record) {
+  char *end;
+  while (getline(&reader->line, &reader->len, reader->files[core]) != -1) {
+    unsigned long timestamp = strtoul(reader->line, &end, 10);
+    while (*end == ' ')
+      end++;
+    if (*end != 'r' && *end != 'w')
+      continue;  // blank or malformed line
+    record->core = core;
+    record->cmd = *end;
+    record->addr = strtoul(end + 1, NULL, 16);
+    if (reader->interleave == INTERLEAVE_ROUND_ROBIN)
+      record->time = reader->n_read[core];
+    else if (reader->interleave == INTERLEAVE_SKEW)
+      record->time = timestamp + core * reader->skew;
+    else
+      record->time = timestamp;
+    reader->n_read[core]++;
+    return true;
+  }
+  return false;
+}
+
+/* Opens the trace (one file per core unless interleave is
+ * INTERLEAVE_FILE). Returns NULL, after saying why, if a per-core name is
+ * malformed or a file can't be read. */
+trace_reader_t *open_trace(const char *trace, int n_core, enum interleave_t interleave, unsigned long skew) {
+  trace_reader_t *reader = malloc(sizeof(trace_reader_t));
+  reader->interleave = interleave;
+  reader->skew = skew;
+  reader->n_file = (interleave == INTERLEAVE_FILE) ? 1 : n_core;
+  reader->paths = calloc(reader->n_file, sizeof(char*));
+  reader->files = calloc(reader->n_file, sizeof(FILE*));
+  reader->n_read = calloc(reader->n_file, sizeof(unsigned long));
+  reader->heap = malloc(reader->n_file * sizeof(trace_record_t));
+  reader->heap_size = 0;
+  reader->line = NULL;
+  reader->len = 0;
+
+  if (interleave != INTERLEAVE_FILE && !valid_per_core_name(trace)) {
+    printf("Per-core traces need exactly one %%d (and no other %%) in the trace name "
+           "for the core id.\n");
+    close_trace(reader);
+    return NULL;
+  }
+  for (int i = 0; i < reader->n_file; i++) {
+    reader->paths[i] = trace_path(trace, interleave == INTERLEAVE_FILE ? -1 : i);
+    reader->files[i] = open_trace_file(reader->paths[i]);
+    if (reader->files[i] == NULL) {
+      close_trace(reader);
+      return NULL;
+    }
+  }
+
+  // prime the merge with the first record of every core
+  if (interleave != INTERLEAVE_FILE) {
+    trace_record_t record;
+    for (int i = 0; i < reader->n_file; i++) {
+      if (read_core_record(reader, i, &record))
+        heap_push(reader, &record);
+    }
+  }
+  return reader;
+}
+
+/* Produces the next record of the global access order. Returns false
+ * once every trace file is exhausted. */
+bool next_record(trace_reader_t *reader, trace_record_t *record) {
+  if (reader->interleave == INTERLEAVE_FILE) {
+    if (getline(&reader->line, &reader->len, reader->files[0]) == -1)
+      return false;
+    record->core = reader->line[0]-'0'; // turn the '0' into a 0
+    record->cmd = reader->line[2];
+    record->addr = strtoul(&reader->line[4], NULL, 16);
+    record->time = reader->n_read[0]++;
+    return true;
+  }
+
+  if (reader->heap_size == 0)
+    return false;
+  *record = reader->heap[0];
+  // refill from the same core, or shrink the heap once it runs dry
+  if (!read_core_record(reader, record->core, &reader->heap[0]))
+    reader->heap[0] = reader->heap[--reader->heap_size];
+  if (reader->heap_size > 0)
+    heap_sift_down(reader);
+  return true;
+}
+
+/* Content hash over every trace file in core order, for the result store. */
+unsigned long hash_trace_reader(trace_reader_t *reader) {
+  unsigned long hash = FNV_OFFSET_BASIS;
+  for (int i = 0; i < reader->n_file; i++)
+    hash = hash_trace_file(hash, reader->paths[i]);
+  return hash;
+}
+
+const char *interleave_name(enum interleave_t interleave) {
+  switch (interleave) {
+  case INTERLEAVE_TIMESTAMP:
+    return "ts";
+  case INTERLEAVE_ROUND_ROBIN:
+    return "rr";
+  case INTERLEAVE_SKEW:
+    return "skew";
+  default:
+    return "file";
+  }
+}
+
+void close_trace(trace_reader_t *reader) {
+  for (int i = 0; i < reader->n_file; i++) {
+    if (reader->files[i] != NULL)
+      fclose(reader->files[i]);
+    free(reader->paths[i]);
+  }
+  free(reader->paths);
+  free(reader->files);
+  free(reader->n_read);
+  free(reader->heap);
+  if (reader->line) free(reader->line);
+  free(reader);
+}
@@ -0,0 +1,45 @@
+#ifndef __TRACE_READER_H
+#define __TRACE_READER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// how the records of per-core trace files are interleaved into one stream
+//   FILE        -- a single pre-interleaved "<core> <r/w> <addr>" trace
+//   TIMESTAMP   -- per-core files merged in timestamp order
+//   ROUND_ROBIN -- per-core files, one record from each core in turn
+//   SKEW        -- like TIMESTAMP, but core i's clock runs i*skew behind
+enum interleave_t { INTERLEAVE_FILE, INTERLEAVE_TIMESTAMP, INTERLEAVE_ROUND_ROBIN, INTERLEAVE_SKEW };
+
+typedef struct {
+  int core;
+  char cmd;            // 'r' or 'w', as in the trace
+  unsigned long addr;
+  unsigned long time;  // merge key, see interleave_t
+} trace_record_t;
+
+typedef struct {
+  enum interleave_t interleave;
+  unsigned long skew;
+
+  int n_file;
+  char **paths;
+  FILE **files;
+  unsigned long *n_read;  // records read so far from each file
+
+  // min-heap holding the next pending record of every unfinished file,
+  // so memory stays at one record per core regardless of trace length
+  trace_record_t *heap;
+  int heap_size;
+
+  char *line;
+  size_t len;
+} trace_reader_t;
+
+trace_reader_t *open_trace(const char *trace, int n_core, enum interleave_t interleave, unsigned long skew);
+bool next_record(trace_reader_t *reader, trace_record_t *record);
+unsigned long hash_trace_reader(trace_reader_t *reader);
+const char *interleave_name(enum interleave_t interleave);
+void close_trace(trace_reader_t *reader);
+
+#endif  // TRACE_READER
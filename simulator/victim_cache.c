@@ -0,0 +1,59 @@
+#include <stdlib.h>
+
+#include "cache.h"
+#include "victim_cache.h"
+
+victim_cache_t *make_victim_cache(int n_entry) {
+  victim_cache_t *victim = malloc(sizeof(victim_cache_t));
+  victim->n_entry = n_entry;
+  victim->lines = malloc(n_entry * sizeof(victim_line_t));
+  for (int i = 0; i < n_entry; i++) {
+    victim->lines[i].block_addr = 0;
+    victim->lines[i].state = INVALID;
+    victim->lines[i].dirty_f = false;
+    victim->lines[i].lru_stamp = 0;
+  }
+  victim->clock = 0;
+  victim->n_lookups = 0;
+  victim->n_hits = 0;
+  victim->n_snoop_hits = 0;
+  return victim;
+}
+
+void free_victim_cache(victim_cache_t *victim) {
+  free(victim->lines);
+  free(victim);
+}
+
+/* Returns the valid entry holding block_addr, or NULL. */
+victim_line_t *victim_find(victim_cache_t *victim, unsigned long block_addr) {
+  for (int i = 0; i < victim->n_entry; i++) {
+    if (victim->lines[i].state != INVALID && victim->lines[i].block_addr == block_addr)
+      return &victim->lines[i];
+  }
+  return NULL;
+}
+
+/* Adds a line evicted from the cache, taking a free entry or else the
+ * least recently inserted one. Returns true and fills in *evicted if a
+ * valid line had to leave the buffer to make room. */
+bool victim_insert(victim_cache_t *victim, unsigned long block_addr, enum state_t state, bool dirty_f, victim_line_t *evicted) {
+  victim_line_t *slot = &victim->lines[0];
+  for (int i = 0; i < victim->n_entry; i++) {
+    if (victim->lines[i].state == INVALID) {
+      slot = &victim->lines[i];
+      break;
+    }
+    if (victim->lines[i].lru_stamp < slot->lru_stamp)
+      slot = &victim->lines[i];
+  }
+  bool evicted_f = (slot->state != INVALID);
+  if (evicted_f)
+    *evicted = *slot;
+
+  slot->block_addr = block_addr;
+  slot->state = state;
+  slot->dirty_f = dirty_f;
+  slot->lru_stamp = ++victim->clock;
+  return evicted_f;
+}
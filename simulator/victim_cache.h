@@ -0,0 +1,34 @@
+#ifndef __VICTIM_CACHE_H
+#define __VICTIM_CACHE_H
+
+#include <stdbool.h>
+
+/* Small fully associative buffer of lines evicted from a cache.
+ *
+ * It is exclusive with its cache: a line lives in one or the other. Lines
+ * keep their coherence state and dirty bit while they sit here, and a
+ * dirty line is only written back once it is pushed out of the buffer.
+ */
+typedef struct {
+  unsigned long block_addr;
+  enum state_t state;  // INVALID marks a free entry
+  bool dirty_f;
+  long lru_stamp;
+} victim_line_t;
+
+typedef struct {
+  int n_entry;
+  victim_line_t *lines;
+  long clock;  // LRU timestamps
+
+  long n_lookups;  // cache misses that checked the buffer
+  long n_hits;
+  long n_snoop_hits;
+} victim_cache_t;
+
+victim_cache_t *make_victim_cache(int n_entry);
+void free_victim_cache(victim_cache_t *victim);
+victim_line_t *victim_find(victim_cache_t *victim, unsigned long block_addr);
+bool victim_insert(victim_cache_t *victim, unsigned long block_addr, enum state_t state, bool dirty_f, victim_line_t *evicted);
+
+#endif  // VICTIM_CACHE